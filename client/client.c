@@ -1,8 +1,24 @@
 #include "client.h"
 
-GameInfo game;
-pthread_mutex_t game_lock = PTHREAD_MUTEX_INITIALIZER;
+// 이중 버퍼: 수신 스레드는 back에 디코딩하고 front와 맞바꿈, 화면 출력은 front만 읽음
+GameInfo buffers[2];
+GameInfo *front = &buffers[0];
+GameInfo *back = &buffers[1];
+pthread_mutex_t swap_lock = PTHREAD_MUTEX_INITIALIZER; // front 교체와 출력 사이 보호
 int player_id;
+FrameReader reader; // 소켓 수신 재조립 버퍼 (수신 스레드 전용)
+Buffer inflated;    // 압축된 키프레임을 푼 내용 (수신 스레드 전용)
+int compress;       // 키프레임 압축 요청 여부 (-z)
+int spectator;      // 관전 모드 (-w): player_id는 카메라가 따라가는 플레이어
+int use_udp;        // UDP 상태 채널 요청 (-u)
+pthread_t update_thread;
+struct sockaddr_in server_addr; // UDP 채널도 같은 서버 주소로
+
+// UDP 상태 채널 (수신 스레드 전용, 서버가 안내를 보내야 열림)
+static int udp_sock = -1;
+static uint32_t udp_token;
+static int udp_confirmed; // 서버가 등록에 응답했는지
+static int udp_hellos;    // 보낸 등록 수
 
 void error_handling(char *message)
 {
@@ -11,154 +27,597 @@ void error_handling(char *message)
     exit(1);
 }
 
-// 현재 게임 보드와 시간을 화면에 출력하는 함수
-void print_board(GameInfo *game, int player_id)
+static int clamp(int v, int lo, int hi)
 {
-    // 화면을 지움
-    clear();
-    printw("Current Game Board (Your team: %c):\n", game->players[player_id].team);
-    printw("Remaining Time: %d seconds\n", game->play_time); // 남은 시간 출력
+    return v < lo ? lo : (v > hi ? hi : v);
+}
 
-    // 보드의 각 행을 돌면서 출력
-    for (int i = 0; i < game->height; i++)
+// 화면에 마지막으로 그린 카메라 영역과 셀 모양 (바뀐 셀만 다시 그리기 위해)
+static char *screen;
+static int screen_x, screen_y, screen_w, screen_h;
+
+// 보냈지만 받은 상태에 아직 반영되지 않은 명령 (입력 스레드 전용)
+static char pending[PREDICT_MAX];
+static int pending_head, pending_count;
+static unsigned int sent_seq; // 지금까지 보낸 명령 수
+
+// 받은 상태 위에 pending을 다시 적용한 결과 (내 위치, 홀수 번 뒤집힌 셀)
+static int pred_x = -1, pred_y = -1;
+static size_t pred_flips[PREDICT_MAX]; // 셀 위치 (y * width + x, 큰 보드에서도 넘치지 않게 size_t)
+static int pred_flip_count;
+// 예측 때문에 받은 상태와 다르게 그렸을 수 있는 셀 (다음 출력에서 다시 확인)
+static size_t predicted_cells[PREDICT_MAX + 2];
+static int predicted_count;
+
+// 예측으로 뒤집혔는지 (있으면 pred_flips 안의 위치, 없으면 -1)
+static int predicted_flip(size_t idx)
+{
+    for (int i = 0; i < pred_flip_count; i++)
     {
-        for (int j = 0; j < game->width; j++)
-        {
-            int player_found = 0;
+        if (pred_flips[i] == idx)
+            return i;
+    }
+    return -1;
+}
 
-            // 모든 플레이어 위치를 확인
-            for (int k = 0; k < game->player_num; k++)
-            {
-                if (game->players[k].y == i && game->players[k].x == j)
-                {
-                    player_found = 1;
-                    // 플레이어의 위치는 팀 색상의 'O'로 표시
-                    attron(COLOR_PAIR(game->players[k].team == RED ? 1 : 2));
-                    printw("[O]");
-                    attroff(COLOR_PAIR(game->players[k].team == RED ? 1 : 2));
-                    break;
-                }
-            }
+// 서버가 처리한 명령은 pending에서 빼고 남은 명령을 받은 상태 위에 다시 적용 (swap_lock 보유 상태에서 호출)
+// 서버와 같은 규칙: 보드 밖 이동은 무시, 타일 위에서만 뒤집기
+static void predict(GameInfo *game)
+{
+    Player *me = &game->players[player_id];
+    unsigned int base = sent_seq - pending_count; // 이미 반영된 것으로 본 명령 수
+    unsigned int acked = (uint16_t)(me->ack - base);
+    if (acked <= (unsigned int)pending_count)
+    { // 더 크면 지난 상태의 ack -> 무시
+        pending_head = (pending_head + acked) % PREDICT_MAX;
+        pending_count -= acked;
+    }
 
-            // 해당 위치에 플레이어가 없을 경우 보드 타일 출력
-            if (!player_found)
-            {
-                if (game->board[i][j] == RED)
-                {
-                    attron(COLOR_PAIR(1)); // 빨간색 타일 설정
-                    printw("[R]");
-                    attroff(COLOR_PAIR(1));
-                }
-                else if (game->board[i][j] == BLUE)
-                {
-                    attron(COLOR_PAIR(2)); // 파란색 타일 설정
-                    printw("[B]");
-                    attroff(COLOR_PAIR(2));
-                }
-                else
-                {
-                    printw("[ ]"); // 빈 타일 출력
-                }
-            }
+    pred_x = me->x;
+    pred_y = me->y;
+    pred_flip_count = 0;
+    for (int i = 0; i < pending_count; i++)
+    {
+        char command = pending[(pending_head + i) % PREDICT_MAX];
+        int x = pred_x + (command == 'r') - (command == 'l');
+        int y = pred_y + (command == 'd') - (command == 'u');
+        if (x >= 0 && x < game->width && y >= 0 && y < game->height)
+        {
+            pred_x = x;
+            pred_y = y;
         }
-        printw("\n");
+        if (command != ' ' || !IN_VIEW(game, pred_x, pred_y))
+            continue;
+        char tile = CELL(game, pred_x, pred_y);
+        if (tile != RED && tile != BLUE)
+            continue;
+        size_t idx = (size_t)pred_y * game->width + pred_x;
+        int k = predicted_flip(idx);
+        if (k >= 0)
+            pred_flips[k] = pred_flips[--pred_flip_count]; // 두 번 뒤집으면 원래대로
+        else
+            pred_flips[pred_flip_count++] = idx;
     }
-    refresh(); // 화면 갱신
 }
 
-// 서버로부터 게임 정보를 수신하고 GameInfo 구조체에 저장하는 함수
-int receive_game_info(int sock, GameInfo *game)
+// 보낸 명령을 예측 대기열에 추가 (가득 차면 가장 오래된 것은 반영된 것으로 봄)
+static void predict_push(char command)
 {
-    pthread_mutex_lock(&game_lock);
+    if (pending_count == PREDICT_MAX)
+    {
+        pending_head = (pending_head + 1) % PREDICT_MAX;
+        pending_count--;
+    }
+    pending[(pending_head + pending_count) % PREDICT_MAX] = command;
+    pending_count++;
+    sent_seq++;
+}
+
+// 셀에 그릴 모양: 타일(' ', 'R', 'B') 또는 플레이어('r', 'b')
+// 내 플레이어는 받은 위치 대신 예측 위치에, 예측으로 뒤집은 타일은 뒤집어서
+static char cell_glyph(GameInfo *game, int x, int y)
+{
+    if (!spectator && x == pred_x && y == pred_y)
+        return game->players[player_id].team == RED ? 'r' : 'b';
+    int occupant = game->occupant[VIEW_INDEX(game, x, y)];
+    if (occupant && (spectator || occupant - 1 != player_id))
+        return game->players[occupant - 1].team == RED ? 'r' : 'b';
+    char tile = CELL(game, x, y);
+    if (predicted_flip((size_t)y * game->width + x) >= 0)
+        tile = tile == RED ? BLUE : RED;
+    return tile;
+}
+
+static void draw_glyph(int row, int col, char glyph)
+{
+    int pair = (glyph == RED || glyph == 'r') ? 1 : (glyph == BLUE || glyph == 'b') ? 2 : 0;
+    const char *text = glyph == 'r' || glyph == 'b' ? "[O]" : glyph == RED ? "[R]" : glyph == BLUE ? "[B]" : "[ ]";
+
+    if (pair)
+        attron(COLOR_PAIR(pair));
+    mvaddstr(row, col, text);
+    if (pair)
+        attroff(COLOR_PAIR(pair));
+}
 
-    if (read(sock, &game->play_time, sizeof(game->play_time)) <= 0)
+// 셀 하나를 화면과 비교해 모양이 달라졌으면 다시 그림 (카메라 밖이면 무시)
+static void refresh_cell(GameInfo *game, int x, int y)
+{
+    if (x < screen_x || x >= screen_x + screen_w || y < screen_y || y >= screen_y + screen_h)
+        return;
+
+    char glyph = cell_glyph(game, x, y);
+    char *shown = &screen[(y - screen_y) * screen_w + (x - screen_x)];
+    if (*shown != glyph)
     {
-        pthread_mutex_unlock(&game_lock);
-        return -1; // 오류 발생
+        *shown = glyph;
+        draw_glyph(3 + y - screen_y, (x - screen_x) * 3, glyph);
     }
+}
 
-    if (read(sock, &game->width, sizeof(game->width)) <= 0)
+// 이번 출력에서 예측 때문에 다르게 그릴 수 있는 셀 (예측 위치, 받은 내 위치, 예측으로 뒤집은 셀)
+static int collect_predicted(GameInfo *game, size_t *cells)
+{
+    Player *me = &game->players[player_id];
+    int count = 0;
+    if (spectator)
+        return 0;
+    if (pred_x >= 0)
+        cells[count++] = (size_t)pred_y * game->width + pred_x;
+    if (me->x >= 0)
+        cells[count++] = (size_t)me->y * game->width + me->x;
+    memcpy(cells + count, pred_flips, pred_flip_count * sizeof(size_t));
+    return count + pred_flip_count;
+}
+
+// 현재 게임 보드와 시간을 화면에 출력하는 함수 (swap_lock 보유 상태에서 front로 호출)
+// 터미널에 들어가는 만큼만, 내 플레이어를 따라가는 카메라로 받은 영역 안을 출력
+// 카메라가 그대로면 지난 출력 이후 바뀐 셀과 예측이 바꾼 셀만 다시 그림
+// 내 플레이어는 서버 응답을 기다리지 않고 보낸 명령까지 적용한 예측 위치에 그림
+void print_board(GameInfo *game, int player_id)
+{
+    Player *me = &game->players[player_id];
+    if (!spectator)
+        predict(game);
+    int me_x = spectator ? me->x : pred_x;
+    int me_y = spectator ? me->y : pred_y;
+    int cam_w = COLS / 3 < game->view.w ? COLS / 3 : game->view.w; // 셀 하나 = 3칸
+    int cam_h = LINES - 3 < game->view.h ? LINES - 3 : game->view.h;
+    if (cam_w <= 0 || cam_h <= 0)
+        return;
+    // 카메라는 플레이어가 가장자리에 다가갈 때만 옮김 (그 외에는 바뀐 셀만 다시 그림)
+    int cam_x = screen_x, cam_y = screen_y;
+    if (me_x < cam_x + CAM_MARGIN || me_x >= cam_x + cam_w - CAM_MARGIN)
+        cam_x = me_x - cam_w / 2;
+    if (me_y < cam_y + CAM_MARGIN || me_y >= cam_y + cam_h - CAM_MARGIN)
+        cam_y = me_y - cam_h / 2;
+    cam_x = clamp(cam_x, game->view.x, game->view.x + game->view.w - cam_w);
+    cam_y = clamp(cam_y, game->view.y, game->view.y + game->view.h - cam_h);
+
+    // 상단 정보는 매번 갱신
+    if (spectator)
+        mvprintw(0, 0, "Watching player %d/%d (team %c) (%d, %d) / %dx%d  [<-/-> to switch]", player_id,
+                 game->player_num, me->team, me_x, me_y, game->width, game->height);
+    else
+        mvprintw(0, 0, "Current Game Board (Your team: %c) (%d, %d) / %dx%d", me->team, me_x, me_y, game->width,
+                 game->height);
+    clrtoeol();
+    mvprintw(1, 0, "Remaining Time: %d.%d seconds", game->play_time / 1000, game->play_time % 1000 / 100); // 남은 시간 출력 (0.1초 단위)
+    clrtoeol();
+    mvprintw(2, 0, "Score - Red: %d  Blue: %d", game->red_tiles, game->blue_tiles); // 현재 점수 출력
+    clrtoeol();
+
+    if (game->full_redraw || cam_x != screen_x || cam_y != screen_y || cam_w != screen_w || cam_h != screen_h)
     {
-        pthread_mutex_unlock(&game_lock);
-        return -1;
+        // 키프레임, 카메라 이동, 터미널 크기 변경 -> 전체 다시 그리기
+        free(screen);
+        screen = malloc((size_t)cam_w * cam_h);
+        screen_x = cam_x;
+        screen_y = cam_y;
+        screen_w = cam_w;
+        screen_h = cam_h;
+
+        move(3, 0);
+        clrtobot();
+        for (int i = 0; i < cam_h; i++)
+        {
+            for (int j = 0; j < cam_w; j++)
+            {
+                char glyph = cell_glyph(game, cam_x + j, cam_y + i);
+                screen[i * cam_w + j] = glyph;
+                draw_glyph(3 + i, j * 3, glyph);
+            }
+        }
+        game->full_redraw = 0;
+    }
+    else
+    {
+        // 바뀐 셀 중 카메라 안에 있고 모양이 달라진 것만
+        for (int k = 0; k < game->dirty_count; k++)
+        {
+            refresh_cell(game, game->view.x + game->dirty_cells[k] % game->view.w,
+                         game->view.y + game->dirty_cells[k] / game->view.w);
+        }
+        // 지난번과 이번 예측이 덮은 셀 (예측이 맞았거나 바뀌었으면 받은 상태대로 돌아감)
+        for (int k = 0; k < predicted_count; k++)
+        {
+            refresh_cell(game, predicted_cells[k] % game->width, predicted_cells[k] / game->width);
+        }
+    }
+    predicted_count = collect_predicted(game, predicted_cells);
+    for (int k = 0; k < predicted_count; k++)
+    {
+        refresh_cell(game, predicted_cells[k] % game->width, predicted_cells[k] / game->width);
     }
 
-    if (read(sock, &game->height, sizeof(game->height)) <= 0)
+    for (int k = 0; k < game->dirty_count; k++)
     {
-        pthread_mutex_unlock(&game_lock);
-        return -1;
+        game->cell_dirty[game->dirty_cells[k]] = 0;
     }
+    game->dirty_count = 0;
+    game->changed = 0;
+    refresh(); // 화면 갱신 (ncurses가 실제로 바뀐 글자만 터미널에 보냄)
+}
 
-    if (read(sock, &game->player_num, sizeof(game->player_num)) <= 0)
+// 프레임 하나를 받을 때까지 소켓에서 읽기 (TCP 조각은 재조립 버퍼에 모음)
+// 압축된 프레임은 풀어서 돌려줌
+int read_frame(int sock, FrameHeader *hdr, const char **payload)
+{
+    int ret;
+    while ((ret = frame_next(&reader, hdr, payload)) == 0)
     {
-        pthread_mutex_unlock(&game_lock);
-        return -1;
+        if (frame_fill(&reader, sock) <= 0)
+            return -1;
     }
+    if (ret < 0)
+        return -1;
+    return frame_inflate(hdr, payload, &inflated);
+}
+
+// 셀 변경 기록 (다음 출력에서 다시 그림)
+static void mark_dirty(GameInfo *game, int x, int y)
+{
+    size_t idx = VIEW_INDEX(game, x, y);
+    if (game->cell_dirty[idx])
+        return;
+    game->cell_dirty[idx] = 1;
+    game->dirty_cells[game->dirty_count++] = idx;
+}
 
-    // 기존 메모리 해제
-    if (game->board)
+// 플레이어를 점유 격자에 올림 (이미 다른 플레이어가 그려지는 셀이면 그대로)
+static void occupy(GameInfo *game, int p)
+{
+    Player *player = &game->players[p];
+    if (!IN_VIEW(game, player->x, player->y))
+        return;
+    int *cell = &game->occupant[VIEW_INDEX(game, player->x, player->y)];
+    if (*cell == 0)
+        *cell = p + 1;
+    mark_dirty(game, player->x, player->y);
+}
+
+// 플레이어가 떠난 셀 정리 (같은 셀에 다른 플레이어가 있으면 그 플레이어를 그림)
+static void vacate(GameInfo *game, int p)
+{
+    Player *player = &game->players[p];
+    if (!IN_VIEW(game, player->x, player->y))
+        return;
+    int *cell = &game->occupant[VIEW_INDEX(game, player->x, player->y)];
+    if (*cell == p + 1)
     {
-        for (int i = 0; i < game->height; i++)
+        *cell = 0;
+        for (int k = 0; k < game->player_num; k++)
         {
-            free(game->board[i]);
+            if (k != p && game->players[k].x == player->x && game->players[k].y == player->y)
+            {
+                *cell = k + 1;
+                break;
+            }
         }
-        free(game->board);
     }
-    if (game->players)
+    mark_dirty(game, player->x, player->y);
+}
+
+// 디코딩 버퍼 확보 -> 영역이나 인원이 커질 때만 다시 할당하고 평소에는 그대로 재사용
+static void arena_reserve(GameInfo *game, size_t cells, int player_num)
+{
+    if (cells > game->cells_cap)
+    {
+        game->board = realloc(game->board, cells);
+        game->occupant = realloc(game->occupant, cells * sizeof(int));
+        game->dirty_cells = realloc(game->dirty_cells, cells * sizeof(int));
+        game->cell_dirty = realloc(game->cell_dirty, cells);
+        if (!game->board || !game->occupant || !game->dirty_cells || !game->cell_dirty)
+            error_handling("realloc() error");
+        game->cells_cap = cells;
+    }
+    if (player_num > game->players_cap)
     {
-        free(game->players);
+        game->players = realloc(game->players, player_num * sizeof(Player));
+        if (game->players == NULL)
+            error_handling("realloc() error");
+        game->players_cap = player_num;
     }
+}
+
+static void arena_free(GameInfo *game)
+{
+    free(game->board);
+    free(game->players);
+    free(game->occupant);
+    free(game->dirty_cells);
+    free(game->cell_dirty);
+}
+
+// 키프레임 적용 -> 관심 영역의 보드와 플레이어 배열 전체 교체
+// 이미 더 새 상태를 적용했으면 버림 (UDP로 먼저 온 상태 뒤에 늦게 도착한 재동기화 키프레임)
+static int decode_keyframe(Cursor *c, GameInfo *game, unsigned int seq)
+{
+    KeyframeHeader h;
+    View view;
+    uint32_t visible;
+
+    if (game->synced && (int)(seq - game->seq) < 0)
+        return 1;
+
+    if (decode_keyframe_header(c, &h) < 0)
+        return -1; // 오류 발생
+
+    view = h.view;
+    if (h.width <= 0 || h.height <= 0 || h.player_num <= 0 ||
+        view.w <= 0 || view.h <= 0 ||
+        view.x + view.w > h.width || view.y + view.h > h.height)
+        return -1;
+    size_t cells = (size_t)view.w * view.h;
+
+    arena_reserve(game, cells, h.player_num);
+    if (decode_cells(c, game->board, cells) < 0 || get_u32(c, &visible) < 0)
+        return -1;
 
-    // 보드 메모리 할당 및 내용 읽기
-    game->board = malloc(game->height * sizeof(char *));
-    for (int i = 0; i < game->height; i++)
+    game->play_time = h.state.play_time;
+    game->red_tiles = h.state.red_count;
+    game->blue_tiles = h.state.blue_count;
+    game->width = h.width;
+    game->height = h.height;
+    game->player_num = h.player_num;
+    game->view = view;
+
+    // 이전 영역의 점유/변경 기록은 버림 (어차피 전체 다시 그림)
+    memset(game->occupant, 0, cells * sizeof(int));
+    memset(game->cell_dirty, 0, cells);
+    game->dirty_count = 0;
+
+    // 영역 밖 플레이어는 위치를 모름 (-1)
+    for (int i = 0; i < h.player_num; i++)
     {
-        game->board[i] = malloc(game->width);
-        if (read(sock, game->board[i], game->width) <= 0)
+        game->players[i].player_id = i;
+        game->players[i].x = game->players[i].y = -1;
+    }
+    for (uint32_t i = 0; i < visible; i++)
+    {
+        PlayerUpdate p;
+        if (decode_player_record(c, &p) < 0)
+            return -1;
+        if (p.player_id < h.player_num)
         {
-            pthread_mutex_unlock(&game_lock);
+            Player *player = &game->players[p.player_id];
+            player->team = p.team;
+            player->x = p.x;
+            player->y = p.y;
+            player->ack = p.ack;
+            occupy(game, p.player_id);
+        }
+    }
+
+    game->seq = seq;
+    game->synced = 1;
+    game->full_redraw = 1;
+    game->changed = 1;
+    return 0;
+}
+
+// 델타 적용 -> 바뀐 셀과 플레이어 위치만 제자리에서 갱신
+// 키프레임 없이 받았거나 시퀀스가 끊긴 경우 내용을 버리고 1 반환
+// 이미 적용한 시퀀스(UDP 중복, 늦게 온 데이터그램)는 동기화를 유지한 채 버림
+static int decode_delta(Cursor *c, GameInfo *game, unsigned int seq)
+{
+    StateHeader h;
+    uint32_t cell_count, move_count;
+    CellUpdate cell;
+    PlayerUpdate move;
+
+    if (game->synced && (int)(seq - game->seq) <= 0)
+        return 1;
+    if (!game->synced || seq != game->seq + 1)
+    {
+        game->synced = 0; // 다음 키프레임까지 대기
+        return 1;
+    }
+
+    if (decode_state_header(c, &h) < 0 || get_u32(c, &cell_count) < 0)
+        return -1;
+
+    for (uint32_t i = 0; i < cell_count; i++)
+    {
+        if (decode_cell_update(c, &cell) < 0)
             return -1;
+        if (IN_VIEW(game, cell.x, cell.y))
+        {
+            CELL(game, cell.x, cell.y) = cell.tile;
+            mark_dirty(game, cell.x, cell.y);
         }
     }
 
-    // 플레이어 배열 메모리 할당 및 내용 읽기
-    game->players = malloc(game->player_num * sizeof(Player));
-    if (read(sock, game->players, game->player_num * sizeof(Player)) <= 0)
+    if (get_u32(c, &move_count) < 0)
+        return -1;
+    for (uint32_t i = 0; i < move_count; i++)
     {
-        pthread_mutex_unlock(&game_lock);
+        if (decode_player_record(c, &move) < 0)
+            return -1;
+        if (move.player_id < game->player_num)
+        {
+            vacate(game, move.player_id);
+            game->players[move.player_id].x = move.x;
+            game->players[move.player_id].y = move.y;
+            game->players[move.player_id].team = move.team;
+            game->players[move.player_id].ack = move.ack;
+            occupy(game, move.player_id);
+        }
+    }
+
+    game->play_time = h.play_time;
+    game->red_tiles = h.red_count;
+    game->blue_tiles = h.blue_count;
+    game->seq = seq;
+    game->changed = 1;
+    return 0;
+}
+
+// 게임 결과 적용
+static int decode_result(Cursor *c, GameInfo *game)
+{
+    GameResult r;
+    if (decode_game_result(c, &r) < 0)
         return -1;
+
+    game->red_tiles = r.red_count;
+    game->blue_tiles = r.blue_count;
+    game->winner = r.winner;
+    game->play_time = 0;
+    game->game_over = 1;
+    return 0;
+}
+
+// 프레임 하나를 버퍼 하나에 적용
+static int apply_frame(GameInfo *game, FrameHeader *hdr, const char *payload)
+{
+    Cursor c = {payload, hdr->length, 0};
+    if (hdr->type == MSG_KEYFRAME)
+        return decode_keyframe(&c, game, hdr->seq);
+    if (hdr->type == MSG_DELTA)
+        return decode_delta(&c, game, hdr->seq);
+    if (hdr->type == MSG_RESULT)
+        return decode_result(&c, game);
+    return 1; // 모르는 메시지는 건너뜀
+}
+
+// 받은 프레임 하나를 게임 상태에 반영 (수신 스레드 전용)
+// back에 디코딩한 뒤 front와 맞바꾸고, 새 back(이전 front)에도 같은 프레임을 적용해 두 버퍼를 맞춤
+// 화면 출력은 포인터를 바꾸는 동안만 기다림 -> 소켓 읽기나 디코딩 중에는 lock을 잡지 않음
+// UDP 상태가 끊겨 동기화를 잃으면 서버에 TCP로 키프레임을 요청
+// 반환값: 0 = 적용, 1 = 동기화 전이거나 지난 상태라 무시, -1 = 오류
+static int apply_received(int sock, FrameHeader *hdr, const char *payload)
+{
+    int was_synced = back->synced;
+    int ret = apply_frame(back, hdr, payload);
+    if (ret != 0)
+    {
+        if (was_synced && !back->synced && udp_sock >= 0)
+        {
+            char resync = CMD_RESYNC;
+            if (write(sock, &resync, 1) < 0)
+                error_handling("Error sending resync request");
+        }
+        return ret;
     }
 
-    pthread_mutex_unlock(&game_lock);
-    return 0; // 성공
+    pthread_mutex_lock(&swap_lock);
+    GameInfo *tmp = front;
+    front = back;
+    back = tmp;
+    pthread_mutex_unlock(&swap_lock);
+
+    // payload는 다음 read_frame 전까지 유효
+    apply_frame(back, hdr, payload);
+    return 0;
+}
+
+// UDP 주소 등록 (응답을 받을 때까지 수신 스레드가 UDP_HELLO_MS마다 다시 보냄)
+static void udp_hello(void)
+{
+    Buffer buf = {0};
+    put_u32(&buf, udp_token);
+    send(udp_sock, buf.data, buf.len, MSG_DONTWAIT);
+    buf_free(&buf);
+    udp_hellos++;
 }
 
-// 타일 카운트 결과를 서버로부터 수신하여 출력하는 함수
-void receive_tile_counts(int sock)
+// 서버의 UDP 채널 안내를 받으면 UDP 소켓을 열고 등록
+static int udp_open(FrameHeader *hdr, const char *payload)
 {
-    int red_count, blue_count;
-    char winner;
+    Cursor c = {payload, hdr->length, 0};
+    uint16_t port;
+    if (get_u16(&c, &port) < 0 || get_u32(&c, &udp_token) < 0)
+        return -1;
+    if (udp_sock >= 0)
+        return 1;
 
-    if (read(sock, &red_count, sizeof(red_count)) <= 0 ||
-        read(sock, &blue_count, sizeof(blue_count)) <= 0 ||
-        read(sock, &winner, sizeof(winner)) <= 0)
+    struct sockaddr_in adr = server_addr;
+    adr.sin_port = htons(port);
+    udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_sock < 0 || connect(udp_sock, (struct sockaddr *)&adr, sizeof(adr)) < 0)
+        error_handling("UDP socket error");
+    udp_hello();
+    return 1;
+}
+
+// 받아 둔 UDP 데이터그램을 모두 처리 (데이터그램 하나에 프레임 1~2개, 이미 적용한 것은 apply에서 버림)
+static int udp_receive(int sock)
+{
+    static char dgram[65536];
+    FrameHeader hdr;
+
+    while (1)
     {
-        error_handling("Error receiving tile counts");
+        ssize_t n = recv(udp_sock, dgram, sizeof(dgram), MSG_DONTWAIT);
+        if (n < 0)
+            return 0; // EAGAIN (연결된 UDP 소켓의 ICMP 오류도 잃은 데이터그램으로 봄)
+        udp_confirmed = 1; // 등록 응답이든 상태든 받았으면 등록된 것
+
+        size_t off = 0;
+        while ((size_t)n - off >= FRAME_HEADER_SIZE)
+        {
+            frame_decode_header(dgram + off, &hdr);
+            if (hdr.version != PROTOCOL_VERSION || hdr.flags != 0 || hdr.length > (size_t)n - off - FRAME_HEADER_SIZE)
+                break; // 잘린 데이터그램은 나머지를 버림
+            const char *payload = dgram + off + FRAME_HEADER_SIZE;
+            off += FRAME_HEADER_SIZE + hdr.length;
+            if ((hdr.type == MSG_KEYFRAME || hdr.type == MSG_DELTA) && apply_received(sock, &hdr, payload) < 0)
+                return -1;
+        }
     }
+}
 
+// 서버로부터 TCP 프레임 하나(키프레임, 델타, 결과, UDP 안내)를 수신하고 게임 상태에 반영하는 함수 (수신 스레드 전용)
+// 반환값: 0 = 적용, 1 = 무시, -1 = 오류
+int receive_game_info(int sock)
+{
+    FrameHeader hdr;
+    const char *payload;
+
+    if (read_frame(sock, &hdr, &payload) < 0)
+        return -1; // 오류 발생
+    if (hdr.type == MSG_UDP_OFFER)
+        return udp_open(&hdr, payload);
+    return apply_received(sock, &hdr, payload);
+}
+
+// 게임 결과를 출력하고 서버에 종료 확인 메시지 전송
+void show_tile_counts(int sock)
+{
     // ncurses 종료
     endwin();
 
     // 결과 출력
     printf("Game Over!\n");
-    printf("Red tiles: %d\n", red_count);
-    printf("Blue tiles: %d\n", blue_count);
+    printf("Red tiles: %d\n", front->red_tiles);
+    printf("Blue tiles: %d\n", front->blue_tiles);
 
-    if (winner == 'R')
+    if (front->winner == 'R')
     {
         printf("Red team wins!\n");
     }
-    else if (winner == 'B')
+    else if (front->winner == 'B')
     {
         printf("Blue team wins!\n");
     }
@@ -180,30 +639,61 @@ void *update_game_info_thread(void *arg)
 {
     int sock = *(int *)arg;
 
-    while (game.play_time > 0)
+    // 결과 메시지를 받을 때까지 (소켓은 이 스레드만 읽음)
+    // 서버로부터 업데이트된 게임 정보를 수신해 적용만 함, 화면 출력은 입력 스레드가 FRAME_MS 간격으로 모아서 함
+    while (!back->game_over)
     {
-        // 서버로부터 업데이트된 게임 정보를 수신
-        if (receive_game_info(sock, &game) < 0)
-            error_handling("Error receiving updated game info");
+        // UDP를 쓰지 않거나 TCP 재조립 버퍼에 이미 받은 바이트가 있으면 TCP부터
+        if (udp_sock < 0 || reader.buf.len > reader.off)
+        {
+            if (receive_game_info(sock) < 0)
+                error_handling("Error receiving updated game info");
+            continue;
+        }
 
-        // 게임 보드 출력
-        print_board(&game, player_id);
-        // 100ms 동안 대기 -> 루프가 너무 빨리 도는것 방지
-        usleep(100000);
+        struct pollfd pfd[2] = {{sock, POLLIN, 0}, {udp_sock, POLLIN, 0}};
+        int n = poll(pfd, 2, udp_confirmed ? -1 : UDP_HELLO_MS);
+        if (n == 0)
+        {
+            if (udp_hellos < UDP_HELLO_TRIES)
+                udp_hello();
+            else
+            { // 응답 없음 (UDP가 막힌 경로) -> 서버는 계속 TCP로 보냄
+                close(udp_sock);
+                udp_sock = -1;
+            }
+            continue;
+        }
+        if (n < 0)
+            continue; // EINTR
+        if ((pfd[1].revents & POLLIN) && udp_receive(sock) < 0)
+            error_handling("Error receiving updated game info");
+        if ((pfd[0].revents & (POLLIN | POLLHUP | POLLERR)) && receive_game_info(sock) < 0)
+            error_handling("Error receiving updated game info");
     }
 
     return NULL;
 }
 
+// 결과를 받았는지 (front 교체와 겹치지 않게 lock 안에서 확인)
+static int is_game_over(void)
+{
+    pthread_mutex_lock(&swap_lock);
+    int over = front->game_over;
+    pthread_mutex_unlock(&swap_lock);
+    return over;
+}
+
 // 게임 루프를 실행 -> 플레이어의 입력 처리 & 서버와 통신
 void *game_loop(void *arg)
 {
     int sock = *(int *)arg;
 
     char command;
-    while (game.play_time > 0)
+    struct timespec last = {0}, now;
+    while (!is_game_over())
     {
-        int ch = getch(); // 키 입력 받기
+        int ch = getch(); // 키 입력 받기 (FRAME_MS마다 돌아와 화면 갱신과 종료 여부 확인)
         switch (ch)
         {
         case KEY_UP:
@@ -222,25 +712,71 @@ void *game_loop(void *arg)
             command = ' '; // 타일 뒤집기 명령
             break;
         default:
-            continue; // 유효하지 않은 키 입력은 무시
+            command = 0; // 유효하지 않은 키 입력은 무시
+            break;
+        }
+
+        // 관전자: 명령 대신 좌우 키로 따라갈 플레이어 변경
+        if (spectator)
+        {
+            if (command == 'l' || command == 'r')
+            {
+                pthread_mutex_lock(&swap_lock);
+                int n = front->player_num;
+                player_id = (player_id + (command == 'r' ? 1 : n - 1)) % n;
+                front->changed = 1;
+                pthread_mutex_unlock(&swap_lock);
+            }
+            command = 0;
         }
 
-        // 명령을 서버로 전송
-        if (write(sock, &command, sizeof(command)) < 0)
-            error_handling("Error sending command");
+        // 명령을 서버로 전송하고 응답을 기다리지 않고 예측에 반영
+        if (command)
+        {
+            if (write(sock, &command, sizeof(command)) < 0)
+                error_handling("Error sending command");
+            predict_push(command);
+        }
+
+        // 바뀐 게 있을 때만, FRAME_MS에 한 번까지 화면 갱신 (내 입력은 바로 보여줌)
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed = (now.tv_sec - last.tv_sec) * 1000 + (now.tv_nsec - last.tv_nsec) / 1000000;
+        if (elapsed >= FRAME_MS || command)
+        {
+            pthread_mutex_lock(&swap_lock);
+            if (front->changed || command)
+            {
+                print_board(front, player_id);
+                last = now;
+            }
+            pthread_mutex_unlock(&swap_lock);
+        }
     }
 
-    // 게임 시간이 0초가 되었을 때 타일 카운트 결과 수신 및 출력
-    receive_tile_counts(sock);
+    // 게임이 끝나면 수신 스레드가 받아 둔 타일 카운트 결과 출력
+    pthread_join(update_thread, NULL);
+    show_tile_counts(sock);
 
     return NULL;
 }
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3)
+    int bad = argc < 3;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-z") == 0)
+            compress = 1; // 키프레임 압축 요청
+        else if (strcmp(argv[i], "-w") == 0)
+            spectator = 1; // 서버의 관전자 포트에 접속
+        else if (strcmp(argv[i], "-u") == 0)
+            use_udp = 1; // 상태를 UDP로 받기 요청
+        else
+            bad = 1;
+    }
+    if (bad)
     {
-        fprintf(stderr, "Usage: %s <IP> <PORT>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <IP> <PORT> [-z] [-w] [-u]\n", argv[0]);
         return 1;
     }
 
@@ -248,19 +784,18 @@ int main(int argc, char *argv[])
     int port = atoi(argv[2]);
 
     int sock;
-    struct sockaddr_in serv_adr;
 
     // 소켓 생성
     sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock < 0)
         error_handling("socket() error");
 
-    memset(&serv_adr, 0, sizeof(serv_adr));
-    serv_adr.sin_family = AF_INET;
-    serv_adr.sin_addr.s_addr = inet_addr(ip);
-    serv_adr.sin_port = htons(port);
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(ip);
+    server_addr.sin_port = htons(port);
 
-    if (connect(sock, (struct sockaddr *)&serv_adr, sizeof(serv_adr)) == -1)
+    if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1)
         error_handling("connect() error");
 
     printf("Press 'y' to confirm connection: ");
@@ -268,17 +803,37 @@ int main(int argc, char *argv[])
     while ((ch = getchar()) != 'y')
         ;
 
-    // 연결 확인 메시지 -> 서버로 전송
-    if (write(sock, &ch, sizeof(ch)) < 0)
+    // 연결 확인 메시지 -> 서버로 전송 (압축, UDP를 쓰면 그 요청을 먼저)
+    char hello[3];
+    int hello_len = 0;
+    if (compress)
+        hello[hello_len++] = HANDSHAKE_COMPRESS;
+    if (use_udp)
+        hello[hello_len++] = HANDSHAKE_UDP;
+    hello[hello_len++] = ch;
+    if (write(sock, hello, hello_len) < 0)
         error_handling("Error sending confirmation");
 
-    // 플레이어 ID 수신
-    if (read(sock, &player_id, sizeof(player_id)) <= 0)
-        error_handling("Error receiving player ID");
+    // 플레이어 ID 수신 (관전자는 ID 없이 바로 키프레임)
+    if (!spectator)
+    {
+        FrameHeader hdr;
+        const char *payload;
+        uint32_t id;
+        if (read_frame(sock, &hdr, &payload) < 0 || hdr.type != MSG_PLAYER_ID)
+            error_handling("Error receiving player ID");
+        Cursor c = {payload, hdr.length, 0};
+        if (get_u32(&c, &id) < 0)
+            error_handling("Error receiving player ID");
+        player_id = id;
+    }
 
-    // from 서버 -> 초기 게임 정보 수신
-    if (receive_game_info(sock, &game) < 0)
-        error_handling("Error receiving game info");
+    // from 서버 -> 초기 게임 정보(키프레임) 수신
+    while (!front->synced)
+    {
+        if (receive_game_info(sock) < 0)
+            error_handling("Error receiving game info");
+    }
 
     // ncurses 초기화 및 설정
     initscr();
@@ -288,9 +843,10 @@ int main(int argc, char *argv[])
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
+    timeout(FRAME_MS); // getch가 FRAME_MS마다 돌아와 화면 갱신과 게임 종료를 확인할 수 있게
     curs_set(0);
 
-    pthread_t update_thread, input_thread;
+    pthread_t input_thread;
 
     // 게임 정보 업데이트를 위한 스레드
     if (pthread_create(&update_thread, NULL, update_game_info_thread, &sock) != 0)
@@ -304,21 +860,21 @@ int main(int argc, char *argv[])
         error_handling("Error creating input thread");
     }
 
-    // 스레드 종료 대기
-    pthread_join(update_thread, NULL);
+    // 스레드 종료 대기 (수신 스레드는 입력 스레드가 join)
     pthread_join(input_thread, NULL);
 
     // ncurses 종료 및 정리
     endwin();
 
     // 메모리 해제
-    for (int i = 0; i < game.height; i++)
-    {
-        free(game.board[i]);
-    }
-    free(game.board);
-    free(game.players);
-
+    arena_free(&buffers[0]);
+    arena_free(&buffers[1]);
+    free(screen);
+    frame_reader_free(&reader);
+    buf_free(&inflated);
+
+    if (udp_sock >= 0)
+        close(udp_sock);
     close(sock);
     return 0;
 }
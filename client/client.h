@@ -10,6 +10,9 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include "protocol.h"
 
 #define RED 'R'
 #define BLUE 'B'
@@ -17,22 +20,42 @@
 #define RIGHT 77
 #define UP 72
 #define DOWN 80
+#define FRAME_MS 33 // 화면 갱신 최소 간격 (약 30fps)
+#define CAM_MARGIN 2 // 플레이어가 카메라 가장자리에 이만큼 다가가면 카메라를 옮김
+#define PREDICT_MAX 256 // 예측으로 다시 적용할, 응답을 기다리는 명령 최대 수
+#define UDP_HELLO_MS 200 // UDP 등록 응답이 없으면 다시 보내는 간격
+#define UDP_HELLO_TRIES 25 // 이만큼 보내도 응답이 없으면 UDP를 포기하고 TCP로만 받음
 
+// 보드 셀 접근 (board는 서버가 보내 준 관심 영역 view.w * view.h만 담음, x/y는 보드 좌표)
+#define VIEW_INDEX(game, cx, cy) ((size_t)((cy) - (game)->view.y) * (game)->view.w + ((cx) - (game)->view.x))
+#define CELL(game, cx, cy) ((game)->board[VIEW_INDEX(game, cx, cy)])
+#define IN_VIEW(game, cx, cy) ((cx) >= (game)->view.x && (cx) < (game)->view.x + (game)->view.w && \
+                               (cy) >= (game)->view.y && (cy) < (game)->view.y + (game)->view.h)
+
+// 화면에 그릴 플레이어 (서버가 보내는 공개 필드만)
 typedef struct
 {
     int player_id;
-    int team;
+    char team;
     int x;
     int y;
-    int ready;
-    int client_sock;
+    unsigned int ack; // 서버가 처리한 이 플레이어의 명령 수 (하위 16비트)
 } Player;
 
 typedef struct
 {
-    char **board;
+    char *board; // 행 우선, view.w * view.h
+    View view;   // 받은 보드 영역 (보드 좌표)
+    int *occupant; // 셀마다 그 위에 그릴 플레이어 (번호 + 1, 0이면 없음)
+    int *dirty_cells;   // 마지막 출력 이후 바뀐 셀 인덱스
+    int dirty_count;
+    char *cell_dirty;   // 셀별 변경 표시 (dirty_cells 중복 방지)
+    int full_redraw;    // 키프레임을 받아 화면 전체를 다시 그려야 함
+    int changed;        // 마지막 출력 이후 적용한 프레임이 있는지
+    size_t cells_cap;   // 위 셀 배열들의 할당 크기 (커질 때만 다시 할당)
+    int players_cap;    // players 할당 크기
     Player *players;
-    int play_time;
+    int play_time; // 남은 시간 (ms)
     int width;
     int height;
     int tile_num;
@@ -40,6 +63,10 @@ typedef struct
     int blue_tiles;
     int players_ready;
     int player_num;
+    unsigned int seq;     // 마지막으로 적용한 메시지 시퀀스 번호
+    int synced;           // 키프레임을 받아 델타를 적용할 수 있는 상태인지
+    int game_over;        // 결과 메시지를 받았는지
+    char winner;          // 승리 팀 ('R', 'B', 'T')
     pthread_mutex_t lock; // 뮤텍스 추가
 } GameInfo;
 
@@ -48,7 +75,9 @@ void connect_to_server(const char *ip, int port, int *sock);
 void *game_loop(void *arg); // 스레드 함수 선언
 void print_board(GameInfo *game, int player_id);
 void send_command(int sock, char command);
-int receive_game_info(int sock, GameInfo *game);
+int read_frame(int sock, FrameHeader *hdr, const char **payload);
+int receive_game_info(int sock);
 void *update_game_info_thread(void *arg); // 스레드 함수 선언
+void show_tile_counts(int sock);
 
 #endif
@@ -0,0 +1,536 @@
+// 부하 생성기: 화면 없는 봇 N개로 서버에 접속해 명령을 보내고
+// 명령 -> ack 지연 시간(p50/p99/p999), 처리량, 수신 바이트를 측정
+// 관전자 연결을 함께 열어 관전자 수에 따른 서버 부담도 볼 수 있음 (-w, -W)
+// -u 1이면 상태를 UDP 채널로 받음 (서버 -L로 손실을 넣어 TCP와 지연 분포 비교)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+
+#define MAX_PENDING 256 // 봇마다 응답을 기다리는 명령 최대 수
+#define MAX_EVENTS 256
+#define UDP_HELLO_NS 200000000L // UDP 등록 응답이 없으면 다시 보내는 간격
+
+typedef struct
+{
+    int fd;
+    int id;              // 서버가 준 플레이어 ID (-1이면 아직 모름)
+    int playing;         // 키프레임을 받아 명령을 보낼 수 있는 상태
+    int done;            // 결과를 받고 종료 확인을 보냄
+    int spectator;       // 관전자 연결 (명령을 보내지 않고 받기만 함)
+    int width, height;   // 보드 크기
+    int pred_x, pred_y;  // 보낸 명령이 모두 적용됐을 때의 위치
+    long pending[MAX_PENDING]; // 응답을 기다리는 명령의 보낸 시각 (보낸 순서대로)
+    int pending_head, pending_count;
+    unsigned int sent;   // 지금까지 보낸 명령 수
+    long next_send_ns;   // 다음 명령을 보낼 시각
+    int udp_fd;          // UDP 상태 채널 (-1이면 TCP로만 받음)
+    uint32_t udp_token;
+    int udp_confirmed;   // 서버가 등록에 응답했는지
+    long udp_hello_ns;   // 마지막으로 등록을 보낸 시각
+    int script_pos;      // 스크립트에서 다음 명령 위치
+    FrameReader reader;
+} Bot;
+
+static Bot *bots;
+static int bot_num = 1;
+static int rate = 10;          // 봇마다 초당 명령 수
+static const char *script;     // 명령 스크립트 (없으면 무작위)
+static int duration = 0;       // 측정 시간 (0이면 게임이 끝날 때까지)
+static int compress;           // 키프레임 압축 요청 여부
+static Buffer inflated;        // 압축된 키프레임을 푼 내용
+static int spectator_num;      // 관전자 연결 수
+static int spectator_port = -1;
+static int use_udp;            // 상태를 UDP 채널로 받기 요청
+static struct sockaddr_in serv_adr;
+static int epfd;
+
+// 통계
+static unsigned *samples; // 지연 시간 (마이크로초)
+static size_t sample_count, sample_cap;
+static long commands_sent, commands_dropped, frames_received, bytes_received;
+static long spectator_frames, spectator_bytes;
+static long udp_datagrams, udp_bytes;
+
+void error_handling(char *message)
+{
+    fputs(message, stderr);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+static long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void add_sample(long ns)
+{
+    if (sample_count == sample_cap)
+    {
+        sample_cap = sample_cap ? sample_cap * 2 : 4096;
+        samples = realloc(samples, sample_cap * sizeof(unsigned));
+        if (samples == NULL)
+            error_handling("realloc() error");
+    }
+    samples[sample_count++] = (unsigned)(ns / 1000);
+}
+
+// 서버가 알려 준 처리한 명령 수 반영: 새로 처리된 명령마다 지연 시간 기록
+static void own_ack(Bot *bot, unsigned int ack, long now)
+{
+    unsigned int base = bot->sent - bot->pending_count;
+    unsigned int acked = (uint16_t)(ack - base);
+    if (acked > (unsigned int)bot->pending_count)
+        return; // 이미 반영한 ack
+    for (unsigned int k = 0; k < acked; k++)
+    {
+        add_sample(now - bot->pending[bot->pending_head]);
+        bot->pending_head = (bot->pending_head + 1) % MAX_PENDING;
+    }
+    bot->pending_count -= acked;
+}
+
+static int decode_keyframe(Bot *bot, Cursor *c, long now)
+{
+    KeyframeHeader h;
+    uint32_t visible;
+
+    if (decode_keyframe_header(c, &h) < 0)
+        return -1;
+    // 봇은 보드 내용이 필요 없음 -> 2비트 셀 영역은 건너뜀
+    size_t cell_bytes = ((size_t)h.view.w * h.view.h + 3) / 4;
+    if (c->len - c->pos < cell_bytes)
+        return -1;
+    c->pos += cell_bytes;
+    if (get_u32(c, &visible) < 0)
+        return -1;
+
+    bot->width = h.width;
+    bot->height = h.height;
+    for (uint32_t i = 0; i < visible; i++)
+    {
+        PlayerUpdate p;
+        if (decode_player_record(c, &p) < 0)
+            return -1;
+        if (p.player_id != bot->id)
+            continue;
+        if (!bot->playing)
+        {
+            // 첫 키프레임: 이때부터 명령을 보냄
+            bot->playing = 1;
+            bot->pred_x = p.x;
+            bot->pred_y = p.y;
+        }
+        own_ack(bot, p.ack, now);
+    }
+    return 0;
+}
+
+static int decode_delta(Bot *bot, Cursor *c, long now)
+{
+    StateHeader h;
+    CellUpdate cell;
+    PlayerUpdate move;
+    uint32_t count;
+
+    if (decode_state_header(c, &h) < 0 || get_u32(c, &count) < 0)
+        return -1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (decode_cell_update(c, &cell) < 0)
+            return -1;
+    }
+    if (get_u32(c, &count) < 0)
+        return -1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (decode_player_record(c, &move) < 0)
+            return -1;
+        if (move.player_id == bot->id)
+            own_ack(bot, move.ack, now);
+    }
+    return 0;
+}
+
+static void udp_hello(Bot *bot, long now)
+{
+    Buffer buf = {0};
+    put_u32(&buf, bot->udp_token);
+    send(bot->udp_fd, buf.data, buf.len, MSG_DONTWAIT);
+    buf_free(&buf);
+    bot->udp_hello_ns = now;
+}
+
+// 서버의 UDP 채널 안내: UDP 소켓을 열어 같은 epoll에 등록하고 주소 등록
+static int udp_open(Bot *bot, Cursor *c, long now)
+{
+    uint16_t port;
+    if (get_u16(c, &port) < 0 || get_u32(c, &bot->udp_token) < 0)
+        return -1;
+    if (bot->udp_fd >= 0)
+        return 0;
+
+    struct sockaddr_in adr = serv_adr;
+    adr.sin_port = htons(port);
+    bot->udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (bot->udp_fd < 0 || connect(bot->udp_fd, (struct sockaddr *)&adr, sizeof(adr)) < 0)
+        error_handling("UDP socket error");
+    fcntl(bot->udp_fd, F_SETFL, fcntl(bot->udp_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = bot;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, bot->udp_fd, &ev);
+    udp_hello(bot, now);
+    return 0;
+}
+
+// 받아 둔 UDP 데이터그램 처리 (봇은 보드가 필요 없음 -> 지난 상태의 ack는 own_ack가 무시)
+static int bot_read_udp(Bot *bot)
+{
+    static char dgram[65536];
+    FrameHeader hdr;
+
+    while (1)
+    {
+        ssize_t n = recv(bot->udp_fd, dgram, sizeof(dgram), MSG_DONTWAIT);
+        if (n < 0)
+            return 0;
+        bot->udp_confirmed = 1;
+        udp_datagrams++;
+        udp_bytes += n;
+        bytes_received += n;
+
+        long now = now_ns();
+        size_t off = 0;
+        while ((size_t)n - off >= FRAME_HEADER_SIZE)
+        {
+            frame_decode_header(dgram + off, &hdr);
+            if (hdr.version != PROTOCOL_VERSION || hdr.flags != 0 || hdr.length > (size_t)n - off - FRAME_HEADER_SIZE)
+                break;
+            Cursor c = {dgram + off + FRAME_HEADER_SIZE, hdr.length, 0};
+            off += FRAME_HEADER_SIZE + hdr.length;
+            frames_received++;
+            if (hdr.type == MSG_KEYFRAME && decode_keyframe(bot, &c, now) < 0)
+                return -1;
+            if (hdr.type == MSG_DELTA && decode_delta(bot, &c, now) < 0)
+                return -1;
+        }
+    }
+}
+
+// 읽을 수 있는 프레임을 모두 처리 (반환값 -1이면 연결 종료)
+static int bot_read(Bot *bot)
+{
+    FrameHeader hdr;
+    const char *payload;
+
+    if (bot->udp_fd >= 0 && bot_read_udp(bot) < 0)
+        return -1;
+
+    while (1)
+    {
+        ssize_t n = frame_fill(&bot->reader, bot->fd);
+        if (n == 0)
+            return -1;
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        if (bot->spectator)
+            spectator_bytes += n;
+        else
+            bytes_received += n;
+
+        long now = now_ns();
+        int ret;
+        while ((ret = frame_next(&bot->reader, &hdr, &payload)) > 0)
+        {
+            if (frame_inflate(&hdr, &payload, &inflated) < 0)
+                return -1;
+            Cursor c = {payload, hdr.length, 0};
+            if (bot->spectator)
+                spectator_frames++;
+            else
+                frames_received++;
+            if (hdr.type == MSG_PLAYER_ID)
+            {
+                uint32_t id;
+                if (get_u32(&c, &id) < 0)
+                    return -1;
+                bot->id = id;
+            }
+            else if (hdr.type == MSG_UDP_OFFER)
+            {
+                if (udp_open(bot, &c, now) < 0)
+                    return -1;
+            }
+            else if (hdr.type == MSG_KEYFRAME)
+            {
+                if (decode_keyframe(bot, &c, now) < 0)
+                    return -1;
+            }
+            else if (hdr.type == MSG_DELTA)
+            {
+                if (decode_delta(bot, &c, now) < 0)
+                    return -1;
+            }
+            else if (hdr.type == MSG_RESULT && !bot->done)
+            {
+                char quit = 'q';
+                send(bot->fd, &quit, 1, MSG_NOSIGNAL);
+                bot->done = 1;
+                bot->playing = 0;
+            }
+        }
+        if (ret < 0)
+            return -1;
+    }
+}
+
+// 다음 명령 고르기 (무작위면 보드 밖으로 나가지 않는 이동과 뒤집기 중에서)
+static char next_command(Bot *bot)
+{
+    if (script)
+    {
+        char cmd = script[bot->script_pos++];
+        if (script[bot->script_pos] == '\0')
+            bot->script_pos = 0;
+        return cmd;
+    }
+
+    while (1)
+    {
+        char cmd = "udlr "[rand() % 5];
+        if ((cmd == 'u' && bot->pred_y == 0) || (cmd == 'd' && bot->pred_y == bot->height - 1) ||
+            (cmd == 'l' && bot->pred_x == 0) || (cmd == 'r' && bot->pred_x == bot->width - 1))
+            continue;
+        return cmd;
+    }
+}
+
+static void bot_send(Bot *bot, long now)
+{
+    char cmd = next_command(bot);
+    if (send(bot->fd, &cmd, 1, MSG_DONTWAIT | MSG_NOSIGNAL) != 1)
+    {
+        commands_dropped++;
+        return;
+    }
+    commands_sent++;
+
+    // 보드 안 이동이면 예측 위치 갱신 (무작위 명령이 보드 밖으로 나가지 않도록)
+    int x = bot->pred_x + (cmd == 'r') - (cmd == 'l');
+    int y = bot->pred_y + (cmd == 'd') - (cmd == 'u');
+    if (x >= 0 && x < bot->width && y >= 0 && y < bot->height)
+    {
+        bot->pred_x = x;
+        bot->pred_y = y;
+    }
+
+    // 모든 명령이 ack로 응답받음 (뒤집기와 보드 밖 이동 포함)
+    if (bot->pending_count == MAX_PENDING)
+    { // 응답이 너무 밀림 -> 가장 오래된 것은 포기
+        bot->pending_head = (bot->pending_head + 1) % MAX_PENDING;
+        bot->pending_count--;
+    }
+    bot->pending[(bot->pending_head + bot->pending_count) % MAX_PENDING] = now;
+    bot->pending_count++;
+    bot->sent++;
+}
+
+static int compare_unsigned(const void *a, const void *b)
+{
+    unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double p)
+{
+    size_t i = (size_t)(p * (sample_count - 1));
+    return samples[i] / 1000.0;
+}
+
+static void report(double seconds)
+{
+    printf("\nBots: %d, time: %.2f s\n", bot_num, seconds);
+    printf("Commands: %ld sent (%.0f/s), %ld dropped\n", commands_sent, commands_sent / seconds, commands_dropped);
+    printf("Frames: %ld received (%.0f/s)\n", frames_received, frames_received / seconds);
+    printf("Bytes: %ld received (%.1f KB/s, %.1f KB per bot)\n", bytes_received,
+           bytes_received / seconds / 1024, bot_num ? (double)bytes_received / bot_num / 1024 : 0.0);
+    if (use_udp)
+        printf("UDP: %ld datagrams, %ld bytes received (included above)\n", udp_datagrams, udp_bytes);
+    if (spectator_num > 0)
+        printf("Spectators: %d, %ld frames, %ld bytes received (%.1f KB/s, %.1f KB per spectator)\n", spectator_num,
+               spectator_frames, spectator_bytes, spectator_bytes / seconds / 1024,
+               (double)spectator_bytes / spectator_num / 1024);
+
+    if (sample_count == 0)
+    {
+        printf("Latency: no samples\n");
+        return;
+    }
+    qsort(samples, sample_count, sizeof(unsigned), compare_unsigned);
+    printf("Latency (%zu samples): p50 %.3f ms, p99 %.3f ms, p999 %.3f ms, max %.3f ms\n",
+           sample_count, percentile(0.50), percentile(0.99), percentile(0.999), samples[sample_count - 1] / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *ip = "127.0.0.1";
+    int port = -1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-i") == 0)
+            ip = argv[i + 1];
+        else if (strcmp(argv[i], "-p") == 0)
+            port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-n") == 0)
+            bot_num = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0)
+            rate = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-m") == 0)
+            script = argv[i + 1];
+        else if (strcmp(argv[i], "-d") == 0)
+            duration = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-z") == 0)
+            compress = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-w") == 0)
+            spectator_num = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-W") == 0)
+            spectator_port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-u") == 0)
+            use_udp = atoi(argv[i + 1]);
+    }
+
+    if (argc % 2 == 0 || port < 0 || bot_num < 0 || bot_num + spectator_num == 0 || rate <= 0 || duration < 0 || (script && script[0] == '\0') ||
+        spectator_num < 0 || (spectator_num > 0 && spectator_port < 0))
+    {
+        fprintf(stderr, "Usage: %s -p <port> [-i <ip>] [-n <bots>] [-r <cmds/s per bot>] [-m <script udlr >] [-d <seconds>] [-z <compress 0|1>] [-w <spectators> -W <spectator port>] [-u <udp 0|1>]\n", argv[0]);
+        return 1;
+    }
+
+    // 봇 수만큼 소켓을 열 수 있도록 fd 한도를 최대로
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    memset(&serv_adr, 0, sizeof(serv_adr));
+    serv_adr.sin_family = AF_INET;
+    serv_adr.sin_addr.s_addr = inet_addr(ip);
+
+    epfd = epoll_create1(0);
+    bots = calloc(bot_num + spectator_num, sizeof(Bot)); // 관전자는 봇 뒤에
+    if (epfd < 0 || bots == NULL)
+        error_handling("setup error");
+
+    // 접속하자마자 준비 완료('y') 전송 (압축, UDP를 쓰면 그 요청을 먼저)
+    long start = now_ns();
+    for (int i = 0; i < bot_num + spectator_num; i++)
+    {
+        Bot *bot = &bots[i];
+        bot->id = -1;
+        bot->udp_fd = -1;
+        bot->spectator = i >= bot_num;
+        serv_adr.sin_port = htons(bot->spectator ? spectator_port : port);
+        bot->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (bot->fd < 0 || connect(bot->fd, (struct sockaddr *)&serv_adr, sizeof(serv_adr)) < 0)
+            error_handling("connect() error");
+
+        int one = 1;
+        setsockopt(bot->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // 1바이트 명령을 바로 보냄
+        fcntl(bot->fd, F_SETFL, fcntl(bot->fd, F_GETFL, 0) | O_NONBLOCK);
+        char hello[3];
+        int hello_len = 0;
+        if (compress)
+            hello[hello_len++] = HANDSHAKE_COMPRESS;
+        if (use_udp && !bot->spectator)
+            hello[hello_len++] = HANDSHAKE_UDP;
+        hello[hello_len++] = 'y';
+        send(bot->fd, hello, hello_len, MSG_NOSIGNAL);
+
+        // 봇마다 보내는 시각을 흩어 놓음
+        if (!bot->spectator)
+            bot->next_send_ns = start + (long)i * (1000000000L / rate) / bot_num;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = bot;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, bot->fd, &ev);
+    }
+    printf("%d bots, %d spectators connected.\n", bot_num, spectator_num);
+
+    long interval_ns = 1000000000L / rate;
+    long deadline = duration > 0 ? start + duration * 1000000000L : 0;
+    int open_bots = bot_num + spectator_num;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (open_bots > 0 && (deadline == 0 || now_ns() < deadline))
+    {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, 1);
+        for (int i = 0; i < n; i++)
+        {
+            Bot *bot = events[i].data.ptr;
+            if (bot_read(bot) < 0)
+            {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, bot->fd, NULL);
+                close(bot->fd);
+                bot->fd = -1;
+                if (bot->udp_fd >= 0)
+                {
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, bot->udp_fd, NULL);
+                    close(bot->udp_fd);
+                    bot->udp_fd = -1;
+                }
+                bot->playing = 0;
+                open_bots--;
+            }
+        }
+
+        // 보낼 때가 된 봇마다 명령 하나씩
+        long now = now_ns();
+        for (int i = 0; i < bot_num; i++)
+        {
+            Bot *bot = &bots[i];
+            if (bot->udp_fd >= 0 && !bot->udp_confirmed && now - bot->udp_hello_ns >= UDP_HELLO_NS)
+                udp_hello(bot, now); // 등록 응답이 없으면 다시
+            if (!bot->playing || now < bot->next_send_ns)
+                continue;
+            bot_send(bot, now);
+            bot->next_send_ns += interval_ns;
+            if (bot->next_send_ns < now)
+                bot->next_send_ns = now + interval_ns; // 밀린 만큼 몰아서 보내지 않음
+        }
+    }
+
+    report((now_ns() - start) / 1e9);
+
+    for (int i = 0; i < bot_num + spectator_num; i++)
+    {
+        if (bots[i].fd >= 0)
+            close(bots[i].fd);
+        if (bots[i].udp_fd >= 0)
+            close(bots[i].udp_fd);
+        frame_reader_free(&bots[i].reader);
+    }
+    free(bots);
+    free(samples);
+    buf_free(&inflated);
+    close(epfd);
+    return 0;
+}
@@ -0,0 +1,450 @@
+#include "protocol.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+static void store_u32(char *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static uint32_t load_u32(const char *p)
+{
+    const unsigned char *u = (const unsigned char *)p;
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+// 최소 extra 바이트를 더 쓸 수 있도록 공간 확보
+void buf_reserve(Buffer *buf, size_t extra)
+{
+    if (buf->len + extra <= buf->cap)
+        return;
+
+    size_t cap = buf->cap ? buf->cap : 256;
+    while (cap < buf->len + extra)
+        cap *= 2;
+    buf->data = realloc(buf->data, cap);
+    if (buf->data == NULL)
+        error_handling("realloc() error");
+    buf->cap = cap;
+}
+
+// 버퍼 끝에 데이터 추가
+void buf_append(Buffer *buf, const void *data, size_t len)
+{
+    buf_reserve(buf, len);
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+void buf_free(Buffer *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+}
+
+// 프레임 시작: 헤더 자리를 비워 두고 시작 위치 반환 (frame_end에서 길이 채움)
+size_t frame_begin(Buffer *buf, char type, uint32_t seq)
+{
+    size_t start = buf->len;
+    char header[FRAME_HEADER_SIZE] = {0};
+
+    header[0] = type;
+    header[2] = PROTOCOL_VERSION & 0xff;
+    header[3] = PROTOCOL_VERSION >> 8;
+    store_u32(header + 8, seq);
+    buf_append(buf, header, sizeof(header));
+    return start;
+}
+
+// 프레임 끝: 헤더에 페이로드 길이 기록
+void frame_end(Buffer *buf, size_t start)
+{
+    store_u32(buf->data + start + 4, (uint32_t)(buf->len - start - FRAME_HEADER_SIZE));
+}
+
+void frame_decode_header(const char *data, FrameHeader *hdr)
+{
+    hdr->type = (uint8_t)data[0];
+    hdr->flags = (uint8_t)data[1];
+    hdr->version = (uint8_t)data[2] | ((uint8_t)data[3] << 8);
+    hdr->length = load_u32(data + 4);
+    hdr->seq = load_u32(data + 8);
+}
+
+// 소켓에서 받을 수 있는 만큼 읽어 재조립 버퍼에 추가 (read 반환값 그대로 반환)
+ssize_t frame_fill(FrameReader *r, int fd)
+{
+    // 이미 꺼낸 앞부분 정리
+    if (r->off > 0)
+    {
+        memmove(r->buf.data, r->buf.data + r->off, r->buf.len - r->off);
+        r->buf.len -= r->off;
+        r->off = 0;
+    }
+
+    buf_reserve(&r->buf, 64 * 1024);
+    ssize_t n;
+    do
+    {
+        n = read(fd, r->buf.data + r->buf.len, r->buf.cap - r->buf.len);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0)
+        r->buf.len += n;
+    return n;
+}
+
+// 완성된 프레임이 있으면 꺼내서 1, 아직 덜 왔으면 0, 잘못된 프레임이면 -1
+// payload는 다음 frame_fill 호출 전까지만 유효
+int frame_next(FrameReader *r, FrameHeader *hdr, const char **payload)
+{
+    size_t avail = r->buf.len - r->off;
+    if (avail < FRAME_HEADER_SIZE)
+        return 0;
+
+    frame_decode_header(r->buf.data + r->off, hdr);
+    if (hdr->version != PROTOCOL_VERSION || hdr->length > FRAME_MAX_LENGTH)
+        return -1;
+    if (avail < FRAME_HEADER_SIZE + (size_t)hdr->length)
+    {
+        // 큰 프레임은 한 번에 받을 수 있게 미리 공간 확보
+        buf_reserve(&r->buf, FRAME_HEADER_SIZE + hdr->length - avail);
+        return 0;
+    }
+
+    *payload = r->buf.data + r->off + FRAME_HEADER_SIZE;
+    r->off += FRAME_HEADER_SIZE + hdr->length;
+    return 1;
+}
+
+// RLE: 제어 바이트 c < 128이면 c + 1개의 바이트가 그대로, 아니면 다음 바이트가 c - 125번 반복
+// 2비트 셀은 같은 색이 이어지면 같은 바이트가 되므로 후반의 넓은 영역이 짧은 반복으로 줄어듦
+#define RLE_MIN_RUN 3
+#define RLE_MAX_RUN (127 + RLE_MIN_RUN)
+#define RLE_MAX_LITERAL 128
+
+static void rle_encode(Buffer *out, const unsigned char *in, size_t len)
+{
+    size_t i = 0, lit = 0; // lit: 아직 내보내지 않은 그대로 복사할 바이트의 시작
+
+    buf_reserve(out, len + len / RLE_MAX_LITERAL + 1); // 최악의 경우 크기
+    while (i <= len)
+    {
+        size_t run = 1;
+        while (i < len && i + run < len && run < RLE_MAX_RUN && in[i + run] == in[i])
+            run++;
+
+        // 반복이 시작되거나 입력이 끝나거나 모인 바이트가 한도에 차면 그대로 복사할 바이트를 내보냄
+        if (i == len || run >= RLE_MIN_RUN || i - lit == RLE_MAX_LITERAL)
+        {
+            while (lit < i)
+            {
+                size_t n = i - lit < RLE_MAX_LITERAL ? i - lit : RLE_MAX_LITERAL;
+                put_u8(out, n - 1);
+                buf_append(out, in + lit, n);
+                lit += n;
+            }
+        }
+        if (i == len)
+            break;
+        if (run >= RLE_MIN_RUN)
+        {
+            put_u8(out, run - RLE_MIN_RUN + 128);
+            put_u8(out, in[i]);
+            i += run;
+            lit = i;
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+static int rle_decode(Buffer *out, const unsigned char *in, size_t len, size_t raw_len)
+{
+    size_t i = 0;
+    buf_reserve(out, raw_len);
+    while (i < len)
+    {
+        unsigned c = in[i++];
+        size_t n = c < 128 ? c + 1 : c - 128 + RLE_MIN_RUN;
+        if (out->len + n > raw_len || i + (c < 128 ? n : 1) > len)
+            return -1;
+        if (c < 128)
+        {
+            memcpy(out->data + out->len, in + i, n);
+            i += n;
+        }
+        else
+        {
+            memset(out->data + out->len, in[i++], n);
+        }
+        out->len += n;
+    }
+    return out->len == raw_len ? 0 : -1;
+}
+
+// 직렬화된 프레임 하나를 페이로드만 RLE 압축해 out에 추가
+// 압축해도 작아지지 않으면 원래 프레임을 그대로 추가
+void frame_compress(Buffer *out, const char *frame, size_t len)
+{
+    size_t start = out->len;
+    size_t payload_len = len - FRAME_HEADER_SIZE;
+
+    buf_append(out, frame, FRAME_HEADER_SIZE);
+    put_u32(out, (uint32_t)payload_len);
+    rle_encode(out, (const unsigned char *)frame + FRAME_HEADER_SIZE, payload_len);
+    if (out->len - start >= len)
+    {
+        out->len = start;
+        buf_append(out, frame, len);
+        return;
+    }
+    out->data[start + 1] |= FRAME_FLAG_RLE;
+    frame_end(out, start);
+}
+
+// 압축된 프레임이면 out에 풀고 payload와 hdr->length를 풀린 내용으로 바꿈 (아니면 그대로)
+// payload는 다음 호출 전까지만 유효, 잘못된 압축 데이터면 -1
+int frame_inflate(FrameHeader *hdr, const char **payload, Buffer *out)
+{
+    Cursor c = {*payload, hdr->length, 0};
+    uint32_t raw_len;
+
+    if (!(hdr->flags & FRAME_FLAG_RLE))
+        return 0;
+    if (get_u32(&c, &raw_len) < 0 || raw_len > FRAME_MAX_LENGTH)
+        return -1;
+
+    out->len = 0;
+    if (rle_decode(out, (const unsigned char *)c.data + c.pos, c.len - c.pos, raw_len) < 0)
+        return -1;
+    *payload = out->data;
+    hdr->length = raw_len;
+    hdr->flags &= ~FRAME_FLAG_RLE;
+    return 0;
+}
+
+void frame_reader_free(FrameReader *r)
+{
+    buf_free(&r->buf);
+    r->off = 0;
+}
+
+// 커서에서 len 바이트 읽기 (남은 데이터가 모자라면 -1)
+int cursor_read(Cursor *c, void *out, size_t len)
+{
+    if (c->len - c->pos < len)
+        return -1;
+    memcpy(out, c->data + c->pos, len);
+    c->pos += len;
+    return 0;
+}
+
+void put_u8(Buffer *buf, uint8_t v)
+{
+    buf_append(buf, &v, 1);
+}
+
+void put_u16(Buffer *buf, uint16_t v)
+{
+    char p[2] = {v & 0xff, v >> 8};
+    buf_append(buf, p, 2);
+}
+
+void put_u32(Buffer *buf, uint32_t v)
+{
+    char p[4];
+    store_u32(p, v);
+    buf_append(buf, p, 4);
+}
+
+// 앞서 자리만 잡아 둔 u32 채우기 (개수처럼 다 쓴 뒤에 아는 값)
+void patch_u32(Buffer *buf, size_t at, uint32_t v)
+{
+    store_u32(buf->data + at, v);
+}
+
+int get_u8(Cursor *c, uint8_t *v)
+{
+    return cursor_read(c, v, 1);
+}
+
+int get_u16(Cursor *c, uint16_t *v)
+{
+    unsigned char p[2];
+    if (cursor_read(c, p, 2) < 0)
+        return -1;
+    *v = p[0] | (p[1] << 8);
+    return 0;
+}
+
+int get_u32(Cursor *c, uint32_t *v)
+{
+    char p[4];
+    if (cursor_read(c, p, 4) < 0)
+        return -1;
+    *v = load_u32(p);
+    return 0;
+}
+
+// u16 필드 여러 개를 int로 읽기
+static int get_u16_ints(Cursor *c, int *out[], int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint16_t v;
+        if (get_u16(c, &v) < 0)
+            return -1;
+        *out[i] = v;
+    }
+    return 0;
+}
+
+void encode_state_header(Buffer *buf, const StateHeader *h)
+{
+    put_u32(buf, (uint32_t)h->play_time);
+    put_u32(buf, (uint32_t)h->red_count);
+    put_u32(buf, (uint32_t)h->blue_count);
+}
+
+int decode_state_header(Cursor *c, StateHeader *h)
+{
+    uint32_t v[3];
+    for (int i = 0; i < 3; i++)
+    {
+        if (get_u32(c, &v[i]) < 0)
+            return -1;
+    }
+    h->play_time = (int32_t)v[0];
+    h->red_count = (int)v[1];
+    h->blue_count = (int)v[2];
+    return 0;
+}
+
+void encode_keyframe_header(Buffer *buf, const KeyframeHeader *h)
+{
+    encode_state_header(buf, &h->state);
+    put_u16(buf, h->width);
+    put_u16(buf, h->height);
+    put_u16(buf, h->player_num);
+    put_u16(buf, h->view.x);
+    put_u16(buf, h->view.y);
+    put_u16(buf, h->view.w);
+    put_u16(buf, h->view.h);
+}
+
+int decode_keyframe_header(Cursor *c, KeyframeHeader *h)
+{
+    int *fields[] = {&h->width, &h->height, &h->player_num, &h->view.x, &h->view.y, &h->view.w, &h->view.h};
+    if (decode_state_header(c, &h->state) < 0)
+        return -1;
+    return get_u16_ints(c, fields, 7);
+}
+
+static uint8_t tile_code(char tile)
+{
+    return tile == 'R' ? CELL_CODE_RED : tile == 'B' ? CELL_CODE_BLUE : CELL_CODE_EMPTY;
+}
+
+static char code_tile(uint8_t code)
+{
+    return code == CELL_CODE_RED ? 'R' : code == CELL_CODE_BLUE ? 'B' : ' ';
+}
+
+// w x h 영역의 셀을 셀당 2비트로 (한 바이트에 4셀, 낮은 비트부터, 행 순서대로 이어서)
+// rows는 영역 왼쪽 위 셀, stride는 한 행의 길이
+void encode_cells(Buffer *buf, const char *rows, size_t stride, int w, int h)
+{
+    size_t n = (size_t)w * h;
+    buf_reserve(buf, (n + 3) / 4);
+    unsigned char *out = (unsigned char *)buf->data + buf->len;
+    memset(out, 0, (n + 3) / 4);
+
+    size_t k = 0;
+    for (int y = 0; y < h; y++)
+    {
+        const char *row = rows + y * stride;
+        for (int x = 0; x < w; x++, k++)
+            out[k >> 2] |= tile_code(row[x]) << ((k & 3) * 2);
+    }
+    buf->len += (n + 3) / 4;
+}
+
+// 2비트 셀 n개를 타일 문자로 풀기
+int decode_cells(Cursor *c, char *out, size_t n)
+{
+    size_t bytes = (n + 3) / 4;
+    if (c->len - c->pos < bytes)
+        return -1;
+
+    const unsigned char *in = (const unsigned char *)c->data + c->pos;
+    for (size_t k = 0; k < n; k++)
+        out[k] = code_tile((in[k >> 2] >> ((k & 3) * 2)) & 3);
+    c->pos += bytes;
+    return 0;
+}
+
+void encode_cell_update(Buffer *buf, const CellUpdate *cell)
+{
+    put_u16(buf, cell->x);
+    put_u16(buf, cell->y);
+    put_u8(buf, tile_code(cell->tile));
+}
+
+int decode_cell_update(Cursor *c, CellUpdate *cell)
+{
+    int *fields[] = {&cell->x, &cell->y};
+    uint8_t code;
+    if (get_u16_ints(c, fields, 2) < 0 || get_u8(c, &code) < 0)
+        return -1;
+    cell->tile = code_tile(code);
+    return 0;
+}
+
+void encode_player_record(Buffer *buf, const PlayerUpdate *p)
+{
+    put_u16(buf, p->player_id);
+    put_u8(buf, p->team);
+    put_u16(buf, p->x);
+    put_u16(buf, p->y);
+    put_u16(buf, p->ack);
+}
+
+int decode_player_record(Cursor *c, PlayerUpdate *p)
+{
+    int *id[] = {&p->player_id};
+    int *pos[] = {&p->x, &p->y};
+    uint8_t team;
+    uint16_t ack;
+    if (get_u16_ints(c, id, 1) < 0 || get_u8(c, &team) < 0 || get_u16_ints(c, pos, 2) < 0 || get_u16(c, &ack) < 0)
+        return -1;
+    p->team = team;
+    p->ack = ack;
+    return 0;
+}
+
+void encode_game_result(Buffer *buf, const GameResult *r)
+{
+    put_u32(buf, r->red_count);
+    put_u32(buf, r->blue_count);
+    put_u8(buf, r->winner);
+}
+
+int decode_game_result(Cursor *c, GameResult *r)
+{
+    uint32_t red, blue;
+    uint8_t winner;
+    if (get_u32(c, &red) < 0 || get_u32(c, &blue) < 0 || get_u8(c, &winner) < 0)
+        return -1;
+    r->red_count = red;
+    r->blue_count = blue;
+    r->winner = winner;
+    return 0;
+}
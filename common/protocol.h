@@ -0,0 +1,180 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 서버 -> 클라이언트 메시지 종류 (프레임 헤더의 type)
+#define MSG_PLAYER_ID 'I' // 플레이어 ID
+#define MSG_KEYFRAME 'K'  // 전체 상태
+#define MSG_DELTA 'D'     // 변경분
+#define MSG_RESULT 'E'    // 게임 결과 (타일 수, 승자)
+#define MSG_UDP_OFFER 'U' // UDP 상태 채널 안내 (포트, 등록 토큰)
+
+// 프레임 헤더: type(1) flags(1) version(2) length(4) seq(4), 리틀 엔디언
+// 버전이 다른 프레임은 잘못된 것으로 간주
+#define FRAME_HEADER_SIZE 12
+#define PROTOCOL_VERSION 4
+#define FRAME_MAX_LENGTH (256u << 20) // 이보다 긴 프레임은 잘못된 것으로 간주
+
+// 프레임 헤더의 flags
+#define FRAME_FLAG_RLE 0x01 // 페이로드가 RLE 압축됨 (u32 원래 길이 + 압축 데이터)
+
+// 클라이언트가 준비('y') 전에 보내면 키프레임을 압축해서 받음
+#define HANDSHAKE_COMPRESS 'z'
+// 클라이언트가 준비('y') 전에 보내면 서버가 UDP 채널을 열어 둔 경우 MSG_UDP_OFFER를 받음
+#define HANDSHAKE_UDP 'U'
+// 게임 중 보내면 현재 키프레임을 TCP로 다시 받음 (UDP 상태를 너무 많이 잃었을 때)
+#define CMD_RESYNC 'k'
+
+// UDP 상태 채널
+//   클라이언트는 MSG_UDP_OFFER의 포트로 u32 토큰 하나만 담은 데이터그램을 보내 주소를 등록 (서버가 같은 토큰으로 응답)
+//   등록 뒤 델타와 주기 키프레임은 UDP로 옴: 데이터그램 하나에 프레임 헤더를 포함한 프레임이 1~2개
+//   (직전 프레임 + 이번 프레임 -> 하나를 잃어도 다음 데이터그램으로 복구, 이미 적용한 시퀀스는 버림)
+//   한 데이터그램에 안 들어가는 프레임, 재동기화 키프레임, 결과는 TCP
+#define UDP_MAX_PAYLOAD 1400 // 데이터그램 최대 크기 (이더넷 MTU 안에서 조각나지 않게)
+
+typedef struct
+{
+    uint8_t type;    // MSG_*
+    uint8_t flags;   // FRAME_FLAG_*
+    uint16_t version; // PROTOCOL_VERSION
+    uint32_t length; // 헤더를 뺀 페이로드 길이
+    uint32_t seq;    // 상태 시퀀스 번호
+} FrameHeader;
+
+// 페이로드는 모두 리틀 엔디언 고정 폭 (호스트 구조체를 그대로 보내지 않음)
+//   ID       u32 player_id
+//   키프레임 KeyframeHeader, 셀 view.w * view.h개 (셀당 2비트), u32 n, 플레이어 레코드 n개
+//   델타     StateHeader, u32 n, 셀 레코드 n개, u32 m, 플레이어 레코드 m개
+//   결과     u32 red, u32 blue, u8 winner
+//   UDP 안내 u16 port, u32 token
+// 좌표, 보드 크기, 플레이어 번호는 u16 -> 최대 WIRE_MAX_DIM
+#define WIRE_MAX_DIM 65535
+
+// 셀 2비트 코드
+#define CELL_CODE_EMPTY 0
+#define CELL_CODE_RED 1
+#define CELL_CODE_BLUE 2
+
+// 델타 메시지의 셀 변경 항목 (u16 x, u16 y, u8 코드 = 5바이트)
+typedef struct
+{
+    int x;
+    int y;
+    char tile; // ' ', 'R', 'B'
+} CellUpdate;
+
+// 플레이어 레코드: 키프레임의 플레이어와 델타의 이동 항목 공통 (u16 id, u8 team, u16 x, u16 y, u16 ack = 9바이트)
+// 시야에 처음 들어온 플레이어도 그릴 수 있게 팀 포함
+// ack: 서버가 처리한 이 플레이어의 명령 수 (하위 16비트) -> 클라이언트는 그 뒤에 보낸 명령만 예측으로 다시 적용
+// 명령은 TCP로 순서대로 가므로 n번째로 보낸 명령의 순번이 곧 n (명령 바이트에 따로 싣지 않음)
+typedef struct
+{
+    int player_id;
+    char team; // 'R', 'B'
+    int x;
+    int y;
+    unsigned int ack;
+} PlayerUpdate;
+
+// 클라이언트가 받는 보드 영역 (관심 영역, 보드 좌표)
+// 키프레임은 이 영역의 셀과 그 안의 플레이어만, 델타도 이 영역 안의 변경만 담음
+typedef struct
+{
+    int x;
+    int y;
+    int w;
+    int h;
+} View;
+
+// 키프레임과 델타 공통 머리 (i32 play_time, u32 red, u32 blue)
+typedef struct
+{
+    int play_time; // 남은 시간 (ms)
+    int red_count;
+    int blue_count;
+} StateHeader;
+
+// 키프레임 머리 (StateHeader, u16 width, height, player_num, view x, y, w, h)
+typedef struct
+{
+    StateHeader state;
+    int width;
+    int height;
+    int player_num;
+    View view;
+} KeyframeHeader;
+
+// 게임 결과
+typedef struct
+{
+    int red_count;
+    int blue_count;
+    char winner; // 'R', 'B', 'T'
+} GameResult;
+
+// 직렬화용 가변 버퍼
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+// 수신 프레임 재조립 버퍼 (TCP가 잘라 보낸 조각을 모아 프레임 단위로 꺼냄)
+typedef struct
+{
+    Buffer buf;
+    size_t off; // buf에서 이미 꺼낸 위치
+} FrameReader;
+
+// 페이로드 읽기 커서
+typedef struct
+{
+    const char *data;
+    size_t len;
+    size_t pos;
+} Cursor;
+
+void error_handling(char *message);
+
+void buf_reserve(Buffer *buf, size_t extra);
+void buf_append(Buffer *buf, const void *data, size_t len);
+void buf_free(Buffer *buf);
+
+size_t frame_begin(Buffer *buf, char type, uint32_t seq);
+void frame_end(Buffer *buf, size_t start);
+void frame_decode_header(const char *data, FrameHeader *hdr);
+
+ssize_t frame_fill(FrameReader *r, int fd);
+int frame_next(FrameReader *r, FrameHeader *hdr, const char **payload);
+void frame_compress(Buffer *out, const char *frame, size_t len);
+int frame_inflate(FrameHeader *hdr, const char **payload, Buffer *out);
+void frame_reader_free(FrameReader *r);
+
+int cursor_read(Cursor *c, void *out, size_t len);
+
+void put_u8(Buffer *buf, uint8_t v);
+void put_u16(Buffer *buf, uint16_t v);
+void put_u32(Buffer *buf, uint32_t v);
+void patch_u32(Buffer *buf, size_t at, uint32_t v);
+int get_u8(Cursor *c, uint8_t *v);
+int get_u16(Cursor *c, uint16_t *v);
+int get_u32(Cursor *c, uint32_t *v);
+
+void encode_state_header(Buffer *buf, const StateHeader *h);
+int decode_state_header(Cursor *c, StateHeader *h);
+void encode_keyframe_header(Buffer *buf, const KeyframeHeader *h);
+int decode_keyframe_header(Cursor *c, KeyframeHeader *h);
+void encode_cells(Buffer *buf, const char *rows, size_t stride, int w, int h);
+int decode_cells(Cursor *c, char *out, size_t n);
+void encode_cell_update(Buffer *buf, const CellUpdate *cell);
+int decode_cell_update(Cursor *c, CellUpdate *cell);
+void encode_player_record(Buffer *buf, const PlayerUpdate *p);
+int decode_player_record(Cursor *c, PlayerUpdate *p);
+void encode_game_result(Buffer *buf, const GameResult *r);
+int decode_game_result(Cursor *c, GameResult *r);
+
+#endif // PROTOCOL_H
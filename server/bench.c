@@ -0,0 +1,125 @@
+#include "server.h"
+
+// 보드 변경 경합 벤치마크: 소켓 없이 여러 스레드가 한 게임에 명령을 적용
+// 명령마다 game->lock을 잡는 예전 방식과 lock 없는 방식의 처리량을 스레드 수별로 비교
+// 바뀐 셀 기록까지 실제 경로를 타도록 스레드마다 BENCH_DRAIN 명령마다 브로드캐스트처럼 가져감
+#define BENCH_SIZE 1024          // 보드 한 변
+#define BENCH_PLAYERS 8          // 스레드마다 맡는 플레이어 수
+#define BENCH_COMMANDS 1000000   // 스레드마다 적용할 명령 수
+#define BENCH_DRAIN 64           // 스레드마다 이만큼 명령을 적용하면 브로드캐스트처럼 바뀐 셀을 가져감
+
+typedef struct
+{
+    GameInfo *game;
+    int first_player; // 이 스레드가 맡은 첫 플레이어
+    int use_lock;     // 1이면 명령마다 game->lock (예전 방식)
+    int hot;          // 1이면 뒤집기만 (모든 플레이어가 같은 칸에 있음)
+    unsigned int seed;
+    pthread_t thread;
+} BenchWorker;
+
+static void *bench_worker(void *arg)
+{
+    BenchWorker *w = arg;
+    for (long i = 0; i < BENCH_COMMANDS; i++)
+    {
+        int p = w->first_player + i % BENCH_PLAYERS;
+        char command = w->hot ? ' ' : "udlr "[rand_r(&w->seed) % 5];
+        if (w->use_lock)
+            pthread_mutex_lock(&w->game->lock); // 통계 없이 lock만 (계측 비용을 빼고 경합만 비교)
+        process_player_command(command, p, w->game);
+        // 실제 게임처럼 바뀐 셀 표시를 주기적으로 지움 -> 다음 변경이 다시 기록 경로를 탐
+        // (다른 스레드가 가져가는 중이면 broadcast_changes처럼 건너뜀)
+        if (i % BENCH_DRAIN == BENCH_DRAIN - 1 && (w->use_lock || pthread_mutex_trylock(&w->game->lock) == 0))
+        {
+            collect_dirty(w->game);
+            clear_dirty(w->game);
+            if (!w->use_lock)
+                pthread_mutex_unlock(&w->game->lock);
+        }
+        if (w->use_lock)
+            pthread_mutex_unlock(&w->game->lock);
+    }
+    return NULL;
+}
+
+// 스레드 threads개로 한 번 실행하고 초당 명령 수 반환 (점수가 보드와 맞지 않으면 -1)
+static double bench_run(int threads, int use_lock, int hot)
+{
+    GameInfo *game = malloc(sizeof(GameInfo));
+    BenchWorker *workers = calloc(threads, sizeof(BenchWorker));
+    if (game == NULL || workers == NULL)
+        error_handling("malloc() error");
+    int player_num = threads * BENCH_PLAYERS;
+    initialize_game(game, BENCH_SIZE, BENCH_SIZE, BENCH_SIZE * BENCH_SIZE / 2, 1, player_num, 1, 1);
+
+    // 경합: 모든 플레이어를 타일 하나 위에 모음
+    int hot_idx = 0;
+    char hot_tile = EMPTY;
+    if (hot)
+    {
+        while (game->board[hot_idx] == EMPTY)
+            hot_idx++;
+        hot_tile = game->board[hot_idx];
+        for (int i = 0; i < player_num; i++)
+        {
+            game->players[i].x = hot_idx % BENCH_SIZE;
+            game->players[i].y = hot_idx / BENCH_SIZE;
+        }
+    }
+
+    long t0 = stats_now_ns();
+    for (int i = 0; i < threads; i++)
+    {
+        BenchWorker *w = &workers[i];
+        w->game = game;
+        w->first_player = i * BENCH_PLAYERS;
+        w->use_lock = use_lock;
+        w->hot = hot;
+        w->seed = i + 1;
+        if (pthread_create(&w->thread, NULL, bench_worker, w) != 0)
+            error_handling("pthread_create() error");
+    }
+    for (int i = 0; i < threads; i++)
+        pthread_join(workers[i].thread, NULL);
+    long elapsed = stats_now_ns() - t0;
+
+    // 뒤집기가 하나도 빠지거나 겹치지 않았는지: 카운터, 비트플레인, 보드가 일치해야 함
+    int red, blue;
+    calculate_tile_counts(game, &red, &blue);
+    int ok = red == game->red_count && blue == game->blue_count && red + blue == game->tile_num;
+    if (hot) // 전체 뒤집기 횟수가 짝수면 처음 색
+        ok = ok && (game->board[hot_idx] == hot_tile) == ((long)threads * BENCH_COMMANDS % 2 == 0);
+
+    destroy_game(game);
+    free(workers);
+    if (!ok)
+        return -1;
+    return (double)threads * BENCH_COMMANDS * 1e9 / elapsed;
+}
+
+// 스레드 1, 2, 4, ... max_threads개로 실행해 표로 출력
+int board_bench(int max_threads)
+{
+    printf("Board mutation benchmark: %dx%d board, %d players and %d commands per thread\n", BENCH_SIZE, BENCH_SIZE,
+           BENCH_PLAYERS, BENCH_COMMANDS);
+    printf("%8s %16s %16s %8s %16s\n", "threads", "global lock/s", "lock-free/s", "speedup", "same tile/s");
+
+    int threads = 1;
+    while (1)
+    {
+        double locked = bench_run(threads, 1, 0);
+        double free_run = bench_run(threads, 0, 0);
+        double hot = bench_run(threads, 0, 1);
+        if (locked < 0 || free_run < 0 || hot < 0)
+        {
+            fprintf(stderr, "Board state mismatch with %d threads\n", threads);
+            return 1;
+        }
+        printf("%8d %16.0f %16.0f %7.2fx %16.0f\n", threads, locked, free_run, free_run / locked, hot);
+        if (threads == max_threads)
+            break;
+        threads = threads * 2 < max_threads ? threads * 2 : max_threads;
+    }
+    return 0;
+}
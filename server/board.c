@@ -0,0 +1,385 @@
+#include "server.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+// 보드 메모리 할당 및 초기화 (width * height 한 덩어리)
+void board_init(GameInfo *game, int use_bitplanes)
+{
+    size_t cells = (size_t)game->width * game->height;
+
+    game->board = malloc(cells);
+    if (game->board == NULL)
+        error_handling("malloc() error");
+    memset(game->board, EMPTY, cells);
+    game->red_count = 0;
+    game->blue_count = 0;
+
+    // 비트플레인: 셀 인덱스 하나당 1비트, 팀별로 한 장씩
+    game->plane_words = (cells + 63) / 64;
+    game->red_bits = NULL;
+    game->blue_bits = NULL;
+    if (use_bitplanes)
+    {
+        game->red_bits = calloc(game->plane_words, sizeof(uint64_t));
+        game->blue_bits = calloc(game->plane_words, sizeof(uint64_t));
+        if (game->red_bits == NULL || game->blue_bits == NULL)
+            error_handling("calloc() error");
+    }
+}
+
+void board_free(GameInfo *game)
+{
+    free(game->board);
+    free(game->red_bits);
+    free(game->blue_bits);
+    free(game->red_buckets);
+    free(game->blue_buckets);
+    game->board = NULL;
+    game->red_bits = game->blue_bits = NULL;
+    game->red_buckets = game->blue_buckets = NULL;
+}
+
+// 셀 값 변경 (점수 카운터와 비트플레인도 함께 갱신, 게임 시작 전 배치용)
+void board_set(GameInfo *game, int x, int y, char tile)
+{
+    size_t idx = (size_t)y * game->width + x;
+    char old = game->board[idx];
+
+    game->red_count += (tile == RED) - (old == RED);
+    game->blue_count += (tile == BLUE) - (old == BLUE);
+    game->board[idx] = tile;
+
+    if (game->red_bits)
+    {
+        uint64_t mask = 1ULL << (idx & 63);
+        size_t w = idx >> 6;
+        if (tile == RED)
+            game->red_bits[w] |= mask;
+        else
+            game->red_bits[w] &= ~mask;
+        if (tile == BLUE)
+            game->blue_bits[w] |= mask;
+        else
+            game->blue_bits[w] &= ~mask;
+    }
+}
+
+// 타일 하나의 해시 (splitmix64 마무리 단계), 보드 해시는 타일이 있는 셀마다 이 값을 XOR한 것
+// 뒤집기는 같은 셀의 두 값을 바꾸는 것이므로 보드 전체를 다시 훑지 않고 갱신할 수 있음
+static uint64_t cell_hash(size_t idx, char tile)
+{
+    uint64_t z = (uint64_t)idx * 2 + (tile == RED) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// 보드 전체의 해시 (스냅샷을 만들거나 불러올 때 한 번, 빈 칸 8개는 한 번에 건너뜀)
+uint64_t board_hash_full(GameInfo *game)
+{
+    const uint64_t empty = 0x0101010101010101ULL * (unsigned char)EMPTY;
+    size_t cells = (size_t)game->width * game->height;
+    uint64_t h = 0;
+    size_t i = 0;
+    while (i < cells)
+    {
+        uint64_t w;
+        if (i + 8 <= cells && (memcpy(&w, game->board + i, 8), w == empty))
+        {
+            i += 8;
+            continue;
+        }
+        size_t end = i + 8 < cells ? i + 8 : cells;
+        for (; i < end; i++)
+        {
+            if (game->board[i] == RED || game->board[i] == BLUE)
+                h ^= cell_hash(i, game->board[i]);
+        }
+    }
+    return h;
+}
+
+// 타일 뒤집기 (RED <-> BLUE), 반환값: 바뀐 타일 (빈 칸이면 0)
+// game->lock 없이 여러 스레드가 호출해도 됨: 셀은 CAS로 바꾸므로 같은 타일을 동시에 뒤집어도 각각 한 번씩 반영
+char board_flip(GameInfo *game, int x, int y)
+{
+    size_t idx = (size_t)y * game->width + x;
+    char old = __atomic_load_n(&game->board[idx], __ATOMIC_RELAXED);
+    char tile;
+
+    do
+    {
+        if (old != RED && old != BLUE)
+            return 0;
+        tile = old == RED ? BLUE : RED;
+    } while (!__atomic_compare_exchange_n(&game->board[idx], &old, tile, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    int d = tile == RED ? 1 : -1;
+    __atomic_add_fetch(&game->red_count, d, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&game->blue_count, d, __ATOMIC_RELAXED);
+
+    // 성공한 CAS마다 두 비트플레인의 비트가 정확히 한 번씩 바뀜
+    if (game->red_bits)
+    {
+        uint64_t mask = 1ULL << (idx & 63);
+        __atomic_xor_fetch(&game->red_bits[idx >> 6], mask, __ATOMIC_RELAXED);
+        __atomic_xor_fetch(&game->blue_bits[idx >> 6], mask, __ATOMIC_RELAXED);
+    }
+    // 위치 색인: 이 칸의 타일 하나가 한 색에서 다른 색으로 옮겨감
+    if (game->red_buckets)
+    {
+        size_t b = (size_t)(y / BUCKET_SIZE) * game->bucket_cols + x / BUCKET_SIZE;
+        __atomic_add_fetch(&game->red_buckets[b], d, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&game->blue_buckets[b], d, __ATOMIC_RELAXED);
+    }
+    if (game->board_hash)
+        __atomic_xor_fetch(game->board_hash, cell_hash(idx, RED) ^ cell_hash(idx, BLUE), __ATOMIC_RELAXED);
+    return tile;
+}
+
+// 팀별 타일 위치 색인 만들기: BUCKET_SIZE 칸마다 색별 타일 수 (배치가 끝난 뒤 한 번, 이후 board_flip이 갱신)
+void board_index_build(GameInfo *game)
+{
+    game->bucket_cols = (game->width + BUCKET_SIZE - 1) / BUCKET_SIZE;
+    game->bucket_rows = (game->height + BUCKET_SIZE - 1) / BUCKET_SIZE;
+    size_t buckets = (size_t)game->bucket_cols * game->bucket_rows;
+    int *red = calloc(buckets, sizeof(int));
+    int *blue = calloc(buckets, sizeof(int));
+    if (red == NULL || blue == NULL)
+        error_handling("calloc() error");
+
+    for (int y = 0; y < game->height; y++)
+    {
+        const char *row = game->board + (size_t)y * game->width;
+        int *red_row = red + (size_t)(y / BUCKET_SIZE) * game->bucket_cols;
+        int *blue_row = blue + (size_t)(y / BUCKET_SIZE) * game->bucket_cols;
+        for (int x = 0; x < game->width; x++)
+        {
+            red_row[x / BUCKET_SIZE] += row[x] == RED;
+            blue_row[x / BUCKET_SIZE] += row[x] == BLUE;
+        }
+    }
+    game->red_buckets = red;
+    game->blue_buckets = blue;
+}
+
+// 색인 칸 하나를 훑어 (x, y)에서 best보다 가까운 tile 색 타일이 있으면 갱신
+static void scan_bucket(GameInfo *game, char tile, int bx, int by, int x, int y, int *best, int *tx, int *ty)
+{
+    int x0 = bx * BUCKET_SIZE, y0 = by * BUCKET_SIZE;
+    int x1 = x0 + BUCKET_SIZE < game->width ? x0 + BUCKET_SIZE : game->width;
+    int y1 = y0 + BUCKET_SIZE < game->height ? y0 + BUCKET_SIZE : game->height;
+
+    for (int cy = y0; cy < y1; cy++)
+    {
+        int dy = abs(cy - y);
+        if (dy >= *best)
+            continue;
+        const char *row = game->board + (size_t)cy * game->width;
+        for (int cx = x0; cx < x1; cx++)
+        {
+            if (row[cx] == tile && dy + abs(cx - x) < *best)
+            {
+                *best = dy + abs(cx - x);
+                *tx = cx;
+                *ty = cy;
+            }
+        }
+    }
+}
+
+// (x, y)에서 맨해튼 거리로 가장 가까운 tile 색 타일 찾기 (반환값: 찾으면 1, board_index_build 후에만)
+// 색인 칸을 가까운 고리부터 보며 타일이 있는 칸만 훑음 -> 고리 r의 칸은 적어도 (r - 1) * BUCKET_SIZE + 1만큼
+// 떨어져 있으므로 이미 찾은 것이 그보다 가까우면 멈춤 (보드 전체를 훑지 않음)
+int board_nearest(GameInfo *game, char tile, int x, int y, int *tx, int *ty)
+{
+    const int *counts = tile == RED ? game->red_buckets : game->blue_buckets;
+    int cols = game->bucket_cols, rows = game->bucket_rows;
+    int bx = x / BUCKET_SIZE, by = y / BUCKET_SIZE;
+    int max_r = bx > cols - 1 - bx ? bx : cols - 1 - bx;
+    if (by > max_r)
+        max_r = by;
+    if (rows - 1 - by > max_r)
+        max_r = rows - 1 - by;
+    int best = INT32_MAX;
+
+    for (int r = 0; r <= max_r && best > (r - 1) * BUCKET_SIZE; r++)
+    {
+        for (int cy = by - r; cy <= by + r; cy++)
+        {
+            if (cy < 0 || cy >= rows)
+                continue;
+            // 고리의 맨 위와 맨 아래 줄은 모든 칸, 나머지 줄은 양 끝 칸만
+            int step = cy == by - r || cy == by + r ? 1 : 2 * r;
+            for (int cx = bx - r; cx <= bx + r; cx += step)
+            {
+                if (cx >= 0 && cx < cols && __atomic_load_n(&counts[(size_t)cy * cols + cx], __ATOMIC_RELAXED) > 0)
+                    scan_bucket(game, tile, cx, cy, x, y, &best, tx, ty);
+            }
+        }
+    }
+    return best != INT32_MAX;
+}
+
+// 64비트 워드 배열의 1비트 개수 (스칼라)
+static long popcount_scalar(const uint64_t *words, size_t n)
+{
+    long total = 0;
+    for (size_t i = 0; i < n; i++)
+        total += __builtin_popcountll(words[i]);
+    return total;
+}
+
+// 보드 바이트 중 RED/BLUE 개수 (스칼라, 분기 없음)
+static void count_bytes_scalar(const char *cells, size_t n, long *red, long *blue)
+{
+    long r = 0, b = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        r += cells[i] == RED;
+        b += cells[i] == BLUE;
+    }
+    *red += r;
+    *blue += b;
+}
+
+#ifdef HAVE_X86_SIMD
+// AVX2 popcount: 4비트 단위 룩업(vpshufb) 후 vpsadbw로 64비트 누적
+__attribute__((target("avx2"))) static long popcount_avx2(const uint64_t *words, size_t n)
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(words + i));
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+    }
+
+    long total = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                 _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+    return total + popcount_scalar(words + i, n - i);
+}
+
+// AVX2 바이트 비교: 32셀씩 비교 후 movemask 비트 수를 더함
+__attribute__((target("avx2,popcnt"))) static void count_bytes_avx2(const char *cells, size_t n, long *red, long *blue)
+{
+    const __m256i red_v = _mm256_set1_epi8(RED);
+    const __m256i blue_v = _mm256_set1_epi8(BLUE);
+    long r = 0, b = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(cells + i));
+        r += __builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, red_v)));
+        b += __builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, blue_v)));
+    }
+    *red += r;
+    *blue += b;
+    count_bytes_scalar(cells + i, n - i, red, blue);
+}
+
+// AVX2 비트플레인 만들기: 32셀 비교의 movemask가 그대로 비트플레인 32비트
+__attribute__((target("avx2"))) static size_t build_planes_avx2(const char *cells, size_t n, uint64_t *red, uint64_t *blue)
+{
+    const __m256i red_v = _mm256_set1_epi8(RED);
+    const __m256i blue_v = _mm256_set1_epi8(BLUE);
+    size_t i = 0;
+
+    for (; i + 64 <= n; i += 64)
+    {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(cells + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(cells + i + 32));
+        red[i >> 6] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, red_v)) |
+                      (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, red_v)) << 32;
+        blue[i >> 6] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, blue_v)) |
+                       (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, blue_v)) << 32;
+    }
+    return i;
+}
+
+static int cpu_has_avx2(void)
+{
+    static int avx2 = -1;
+    if (avx2 < 0)
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return avx2;
+}
+#endif
+
+// 타일 카운트 계산
+// 비트플레인이 있으면 popcount, 없으면 보드 바이트 비교 (둘 다 AVX2 우선, 스칼라 대체)
+void calculate_tile_counts(GameInfo *game, int *red_count, int *blue_count)
+{
+    long red = 0, blue = 0;
+
+    if (game->red_bits)
+    {
+#ifdef HAVE_X86_SIMD
+        if (cpu_has_avx2())
+        {
+            red = popcount_avx2(game->red_bits, game->plane_words);
+            blue = popcount_avx2(game->blue_bits, game->plane_words);
+        }
+        else
+#endif
+        {
+            red = popcount_scalar(game->red_bits, game->plane_words);
+            blue = popcount_scalar(game->blue_bits, game->plane_words);
+        }
+    }
+    else
+    {
+        size_t cells = (size_t)game->width * game->height;
+#ifdef HAVE_X86_SIMD
+        if (cpu_has_avx2())
+            count_bytes_avx2(game->board, cells, &red, &blue);
+        else
+#endif
+            count_bytes_scalar(game->board, cells, &red, &blue);
+    }
+
+    *red_count = (int)red;
+    *blue_count = (int)blue;
+}
+
+// 이미 채워진 셀을 그대로 보드로 사용 (스냅샷/맵 파일 매핑, 해제는 매핑한 쪽 몫)
+// 점수 카운터와 비트플레인은 셀에서 다시 계산 (AVX2 우선, 스칼라 대체)
+void board_adopt(GameInfo *game, char *cells, int use_bitplanes)
+{
+    size_t n = (size_t)game->width * game->height;
+
+    game->board = cells;
+    game->plane_words = (n + 63) / 64;
+    game->red_bits = NULL;
+    game->blue_bits = NULL;
+    if (use_bitplanes)
+    {
+        game->red_bits = calloc(game->plane_words, sizeof(uint64_t));
+        game->blue_bits = calloc(game->plane_words, sizeof(uint64_t));
+        if (game->red_bits == NULL || game->blue_bits == NULL)
+            error_handling("calloc() error");
+
+        size_t i = 0;
+#ifdef HAVE_X86_SIMD
+        if (cpu_has_avx2())
+            i = build_planes_avx2(cells, n, game->red_bits, game->blue_bits);
+#endif
+        for (; i < n; i++)
+        {
+            game->red_bits[i >> 6] |= (uint64_t)(cells[i] == RED) << (i & 63);
+            game->blue_bits[i >> 6] |= (uint64_t)(cells[i] == BLUE) << (i & 63);
+        }
+    }
+    calculate_tile_counts(game, &game->red_count, &game->blue_count);
+}
@@ -0,0 +1,77 @@
+#include "server.h"
+
+// 서버 봇: 가장 가까운 상대 색 타일로 한 칸씩 걸어가 뒤집음
+struct Bot
+{
+    int p_num;      // 봇이 차지한 플레이어 자리
+    int has_target; // 목표 타일이 있음
+    int tx;         // 목표 타일 위치
+    int ty;
+};
+
+// 마지막 bot_num개 플레이어 자리를 봇으로 채움 (처음부터 준비 완료, 연결 없음)
+// 사람 모집이 끝난 뒤 main에서 호출 -> 사람이 모두 먼저 준비했으면 마지막 'y' 대신 여기서 게임을 시작시킴
+// epoll_mode: 리액터가 연결을 맡고 있으면 1 (시작할 때 리액터가 키프레임을 보냄), 스레드 모드면 0
+void bots_start(GameInfo *game, int bot_num, int epoll_mode)
+{
+    Bot *bots = calloc(bot_num, sizeof(Bot));
+    if (bots == NULL)
+        error_handling("calloc() error");
+    board_index_build(game);
+
+    game_lock(game);
+    game->bots = bots;
+    game->bot_num = bot_num;
+    for (int i = 0; i < bot_num; i++)
+    {
+        Bot *bot = &game->bots[i];
+        bot->p_num = game->player_num - bot_num + i;
+        game->players[bot->p_num].ready = 1;
+    }
+    game->players_ready += bot_num;
+    if (game->players_ready == game->player_num)
+    {
+        if (epoll_mode)
+            reactor_start_game(game);
+        else
+            pthread_cond_broadcast(&game->start_cond); // main과 핸들러 스레드가 기다리는 중
+    }
+    game_unlock(game);
+}
+
+// 모든 봇이 한 걸음씩 (게임 시계 스레드에서 호출, 명령은 사람과 같은 경로로 적용)
+// 목표가 없거나 다른 플레이어가 먼저 뒤집었을 때만 위치 색인으로 다시 찾음
+void bots_step(GameInfo *game)
+{
+    long t0 = stats_now_ns();
+    for (int i = 0; i < game->bot_num; i++)
+    {
+        Bot *bot = &game->bots[i];
+        Player *p = &game->players[bot->p_num];
+        char want = p->team == RED ? BLUE : RED;
+
+        if (!bot->has_target || __atomic_load_n(&CELL(game, bot->tx, bot->ty), __ATOMIC_RELAXED) != want)
+            bot->has_target = board_nearest(game, want, p->x, p->y, &bot->tx, &bot->ty);
+        if (!bot->has_target)
+            continue; // 뒤집을 타일이 없음
+
+        // 멀리 떨어진 축부터 한 칸 이동, 도착했으면 뒤집기
+        int dx = bot->tx - p->x, dy = bot->ty - p->y;
+        char command;
+        if (dx == 0 && dy == 0)
+            command = ' ';
+        else if (abs(dx) >= abs(dy))
+            command = dx > 0 ? 'r' : 'l';
+        else
+            command = dy > 0 ? 'd' : 'u';
+        process_player_command(command, bot->p_num, game);
+    }
+    stats_record(ST_BOT_STEP, stats_now_ns() - t0);
+}
+
+void bots_free(GameInfo *game)
+{
+    free(game->bots);
+    game->bots = NULL;
+    game->bot_num = 0;
+}
@@ -0,0 +1,326 @@
+#include "server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define FLUSH_IOV 16 // sendmsg 한 번에 묶어 보낼 최대 프레임 수
+
+// 연결 생성 (epfd < 0이면 스레드 모드: 핸들러 스레드가 conn_recv에서 송신 큐도 비움)
+Connection *conn_create(GameInfo *game, int fd, int p_num, int epfd)
+{
+    Connection *conn = calloc(1, sizeof(Connection));
+    if (conn == NULL)
+        error_handling("calloc() error");
+
+    conn->ev_type = EV_CONN;
+    conn->fd = fd;
+    conn->p_num = p_num;
+    conn->state = CONN_HANDSHAKE;
+    conn->epfd = epfd;
+    conn->wake_fd = epfd < 0 ? eventfd(0, EFD_NONBLOCK) : -1;
+    conn->game = game;
+    conn->ring = calloc(OUTQ_FRAMES, sizeof(OutFrame));
+    pthread_mutex_init(&conn->out_lock, NULL);
+
+    // 송신은 항상 논블로킹 -> 느린 클라이언트가 브로드캐스트를 막지 않음
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    // 작은 델타를 Nagle로 묶어 두지 않고 바로 보냄 (프레임은 이미 sendmsg로 모아 보냄)
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return conn;
+}
+
+// 큐에 남은 프레임 해제 (out_lock 보유 상태에서 호출)
+static void ring_clear(Connection *conn)
+{
+    for (int i = 0; i < conn->ring_count; i++)
+    {
+        shared_release(conn->ring[(conn->ring_head + i) % OUTQ_FRAMES].buf);
+    }
+    conn->ring_head = conn->ring_count = 0;
+    conn->head_off = 0;
+    conn->queued_bytes = 0;
+}
+
+void conn_destroy(Connection *conn)
+{
+    ring_clear(conn);
+    shared_release(conn->udp_prev);
+    free(conn->ring);
+    if (conn->wake_fd >= 0)
+        close(conn->wake_fd);
+    pthread_mutex_destroy(&conn->out_lock);
+    free(conn);
+}
+
+// 아직 보내기 시작하지 않은 상태 프레임(키프레임/델타)을 모두 버림 (out_lock 보유 상태에서 호출)
+// 보내는 중인 맨 앞 프레임과 제어 프레임은 유지
+static void ring_drop_states(Connection *conn)
+{
+    OutFrame kept[OUTQ_FRAMES];
+    int count = 0;
+
+    for (int i = 0; i < conn->ring_count; i++)
+    {
+        OutFrame *f = &conn->ring[(conn->ring_head + i) % OUTQ_FRAMES];
+        if ((i == 0 && conn->head_off > 0) || f->kind == OUT_CONTROL)
+        {
+            kept[count++] = *f;
+        }
+        else
+        {
+            conn->queued_bytes -= f->buf->len;
+            conn->coalesced++;
+            shared_release(f->buf);
+        }
+    }
+
+    memcpy(conn->ring, kept, count * sizeof(OutFrame));
+    conn->ring_head = 0;
+    conn->ring_count = count;
+}
+
+// 송신 큐가 비었는지에 따라 쓰기 대기 등록/해제 (out_lock 보유 상태에서 호출)
+static void conn_update_interest(Connection *conn)
+{
+    int want = conn->ring_count > 0;
+    if (want == conn->want_write)
+        return;
+
+    if (conn->epfd >= 0)
+    {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | (want ? EPOLLOUT : 0);
+        ev.data.ptr = conn;
+        epoll_ctl(conn->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+    }
+    else if (want)
+    {
+        // 스레드 모드: poll 중인 핸들러를 깨워 POLLOUT을 기다리게 함
+        uint64_t v = 1;
+        write(conn->wake_fd, &v, sizeof(v));
+    }
+    conn->want_write = want;
+}
+
+// 송신 큐를 소켓이 받아주는 만큼 전송 (out_lock 보유 상태에서 호출)
+// 여러 프레임을 sendmsg 한 번으로 묶어 보냄
+void conn_flush(Connection *conn)
+{
+    while (conn->ring_count > 0)
+    {
+        struct iovec iov[FLUSH_IOV];
+        int n = 0;
+        for (int i = 0; i < conn->ring_count && n < FLUSH_IOV; i++)
+        {
+            OutFrame *f = &conn->ring[(conn->ring_head + i) % OUTQ_FRAMES];
+            size_t off = i == 0 ? conn->head_off : 0;
+            iov[n].iov_base = f->buf->data + off;
+            iov[n].iov_len = f->buf->len - off;
+            n++;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t sent = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+        stats_count(ST_SYSCALLS, 1);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            // 전송 오류 -> 남은 데이터 버리고 읽기 쪽이 종료를 감지하도록
+            ring_clear(conn);
+            shutdown(conn->fd, SHUT_RDWR);
+            break;
+        }
+
+        // 보낸 만큼 맨 앞 프레임부터 제거
+        stats_count(ST_BYTES_SENT, sent);
+        conn->queued_bytes -= sent;
+        while (sent > 0)
+        {
+            OutFrame *f = &conn->ring[conn->ring_head];
+            size_t left = f->buf->len - conn->head_off;
+            if ((size_t)sent < left)
+            {
+                conn->head_off += sent;
+                break;
+            }
+            sent -= left;
+            shared_release(f->buf);
+            conn->ring_head = (conn->ring_head + 1) % OUTQ_FRAMES;
+            conn->ring_count--;
+            conn->head_off = 0;
+        }
+    }
+
+    conn_update_interest(conn);
+}
+
+// Buffer의 내용을 복사 없이 넘겨받아 공유 프레임으로 (buf는 빈 상태가 됨, 참조 1개)
+SharedBuf *shared_wrap(Buffer *buf)
+{
+    SharedBuf *sb = malloc(sizeof(SharedBuf));
+    if (sb == NULL)
+        error_handling("malloc() error");
+    sb->refs = 1;
+    sb->data = buf->data;
+    sb->len = buf->len;
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+    return sb;
+}
+
+void shared_release(SharedBuf *sb)
+{
+    if (sb && __atomic_sub_fetch(&sb->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        free(sb->data);
+        free(sb);
+    }
+}
+
+// 공유 프레임을 송신 큐에 넣고 가능한 만큼 바로 전송 (어느 스레드에서나 호출 가능)
+// 큐에는 참조만 넣음 -> 받는 연결이 많아도 프레임은 하나
+// 반환값: 0 = 큐에 넣음, 1 = 클라이언트가 밀려 델타를 버림 -> 호출자가 키프레임을 보내야 함
+int conn_send_shared(Connection *conn, SharedBuf *buf, int kind)
+{
+    int ret = 0;
+    size_t len = buf->len;
+
+    pthread_mutex_lock(&conn->out_lock);
+    if (conn->state == CONN_CLOSED)
+        goto out;
+
+    if (kind == OUT_DELTA)
+    {
+        // 이미 밀려 있으면 다음 키프레임 전까지 델타는 의미 없음
+        if (conn->need_keyframe)
+        {
+            ret = 1;
+            goto out;
+        }
+        // 큐가 한도를 넘으면 쌓인 상태를 버리고 최신 키프레임으로 대체
+        if (conn->ring_count == OUTQ_FRAMES || conn->queued_bytes + len > OUTQ_MAX_BYTES)
+        {
+            ring_drop_states(conn);
+            conn->need_keyframe = 1;
+            ret = 1;
+            goto out;
+        }
+    }
+    else if (kind == OUT_KEYFRAME)
+    {
+        // 새 키프레임이 아직 안 보낸 이전 상태를 모두 대체
+        ring_drop_states(conn);
+        conn->need_keyframe = 0;
+    }
+
+    if (conn->ring_count == OUTQ_FRAMES)
+    {
+        // 제어 프레임만으로 큐가 가득 참 -> 더 이상 따라올 수 없는 클라이언트
+        ring_clear(conn);
+        shutdown(conn->fd, SHUT_RDWR);
+        goto out;
+    }
+
+    OutFrame *f = &conn->ring[(conn->ring_head + conn->ring_count) % OUTQ_FRAMES];
+    __atomic_add_fetch(&buf->refs, 1, __ATOMIC_RELAXED);
+    f->buf = buf;
+    f->kind = kind;
+    conn->ring_count++;
+    conn->queued_bytes += len;
+    stats_record(ST_QUEUE_DEPTH, conn->ring_count);
+
+    conn_flush(conn);
+
+out:
+    pthread_mutex_unlock(&conn->out_lock);
+    return ret;
+}
+
+// 한 연결에만 보내는 프레임 (복사해서 큐에 넣음)
+int conn_send(Connection *conn, const void *data, size_t len, int kind)
+{
+    Buffer copy = {0};
+    buf_append(&copy, data, len);
+    SharedBuf *sb = shared_wrap(&copy);
+    int ret = conn_send_shared(conn, sb, kind);
+    shared_release(sb);
+    return ret;
+}
+
+// 소켓을 닫고 남은 송신 데이터 폐기 (epoll 등록 해제는 호출자 몫)
+void conn_shutdown(Connection *conn)
+{
+    pthread_mutex_lock(&conn->out_lock);
+    if (conn->state != CONN_CLOSED)
+    {
+        conn->state = CONN_CLOSED;
+        if (conn->epfd >= 0)
+            epoll_ctl(conn->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+        close(conn->fd);
+        ring_clear(conn);
+    }
+    pthread_mutex_unlock(&conn->out_lock);
+}
+
+// 스레드 모드 수신: 데이터가 올 때까지 기다리면서 그동안 송신 큐도 비움
+ssize_t conn_recv(Connection *conn, void *buf, size_t len)
+{
+    while (1)
+    {
+        ssize_t n = recv(conn->fd, buf, len, 0);
+        if (n >= 0)
+            return n;
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+
+        struct pollfd pfd[2];
+        pthread_mutex_lock(&conn->out_lock);
+        pfd[0].fd = conn->fd;
+        pfd[0].events = POLLIN | (conn->ring_count > 0 ? POLLOUT : 0);
+        pthread_mutex_unlock(&conn->out_lock);
+        pfd[1].fd = conn->wake_fd;
+        pfd[1].events = POLLIN;
+
+        if (poll(pfd, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (pfd[1].revents & POLLIN)
+        {
+            uint64_t v;
+            read(conn->wake_fd, &v, sizeof(v));
+        }
+        if (pfd[0].revents & POLLOUT)
+        {
+            pthread_mutex_lock(&conn->out_lock);
+            conn_flush(conn);
+            pthread_mutex_unlock(&conn->out_lock);
+        }
+    }
+}
+
+// 송신 큐에 쌓인 프레임 수
+int conn_queue_depth(Connection *conn)
+{
+    pthread_mutex_lock(&conn->out_lock);
+    int depth = conn->ring_count;
+    pthread_mutex_unlock(&conn->out_lock);
+    return depth;
+}
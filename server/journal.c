@@ -0,0 +1,223 @@
+#include "server.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 명령 저널 파일 (모두 리틀 엔디언)
+//   머리: "TJNL", u16 버전, u32 seed, u16 width, height, player_num, u32 tile_num, play_time (ms), tick_rate, u8 bitplanes
+//   레코드: u32 tick, u16 player, u8 command (7바이트, 적용한 순서대로)
+#define JOURNAL_MAGIC "TJNL"
+#define JOURNAL_VERSION 3 // 배치 방식이나 머리 형식이 바뀌면 올림 (같은 시드라도 다른 게임)
+#define JOURNAL_HEADER_SIZE 29
+#define JOURNAL_RECORD_SIZE 7
+#define JOURNAL_FLUSH_BYTES (64 * 1024) // 이만큼 모이면 쓰기 스레드에 넘김
+
+struct Journal
+{
+    int fd;
+    Buffer buf; // 아직 넘기지 않은 레코드 (명령 스레드가 채움)
+    Buffer out; // 쓰기 스레드가 파일에 쓰는 중인 레코드 (비어 있어야 buf를 넘김 -> 순서 유지)
+    long records;
+    int closing;          // journal_close가 쓰기 스레드에 끝을 알림
+    pthread_mutex_t lock; // 여러 명령 스레드가 동시에 기록 (write()는 lock 밖에서)
+    pthread_cond_t cond;  // out이 찼거나 닫는 중
+    pthread_t writer;
+};
+
+static void journal_write(int fd, const Buffer *buf)
+{
+    size_t off = 0;
+    while (off < buf->len)
+    {
+        ssize_t n = write(fd, buf->data + off, buf->len - off);
+        if (n < 0)
+            error_handling("journal write() error");
+        off += n;
+    }
+}
+
+// 모인 레코드를 쓰기 스레드에 넘김 (j->lock 보유 상태에서 호출, 쓰는 중이면 계속 모음)
+static void journal_hand_off(Journal *j)
+{
+    if (j->out.len > 0)
+        return;
+    Buffer tmp = j->out;
+    j->out = j->buf;
+    j->buf = tmp;
+    pthread_cond_signal(&j->cond);
+}
+
+// 쓰기 스레드: 넘겨받은 레코드를 파일에 씀 -> 디스크가 느려도 명령 스레드는 lock만 잠깐 잡음
+static void *journal_writer(void *arg)
+{
+    Journal *j = arg;
+    pthread_mutex_lock(&j->lock);
+    while (1)
+    {
+        while (j->out.len == 0 && !j->closing)
+            pthread_cond_wait(&j->cond, &j->lock);
+        if (j->out.len == 0)
+            break;
+        pthread_mutex_unlock(&j->lock);
+        journal_write(j->fd, &j->out);
+        pthread_mutex_lock(&j->lock);
+        j->out.len = 0;
+        if (j->buf.len >= JOURNAL_FLUSH_BYTES)
+            journal_hand_off(j); // 쓰는 동안 다시 찼음
+    }
+    pthread_mutex_unlock(&j->lock);
+    return NULL;
+}
+
+// 저널 파일을 만들고 게임 설정을 머리에 기록 (initialize_game 다음에 호출)
+Journal *journal_open(const char *path, GameInfo *game)
+{
+    Journal *j = calloc(1, sizeof(Journal));
+    if (j == NULL)
+        error_handling("calloc() error");
+    j->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (j->fd < 0)
+        error_handling("journal open() error");
+    pthread_mutex_init(&j->lock, NULL);
+    pthread_cond_init(&j->cond, NULL);
+    if (pthread_create(&j->writer, NULL, journal_writer, j) != 0)
+        error_handling("pthread_create() error");
+
+    buf_append(&j->buf, JOURNAL_MAGIC, 4);
+    put_u16(&j->buf, JOURNAL_VERSION);
+    put_u32(&j->buf, game->seed);
+    put_u16(&j->buf, game->width);
+    put_u16(&j->buf, game->height);
+    put_u16(&j->buf, game->player_num);
+    put_u32(&j->buf, game->tile_num);
+    put_u32(&j->buf, game->play_time);
+    put_u32(&j->buf, game->tick_rate);
+    put_u8(&j->buf, game->red_bits != NULL);
+    return j;
+}
+
+// 적용한 명령 하나 기록 (명령 스레드마다 호출)
+// 플레이어 사이의 기록 순서는 실제 적용 순서와 다를 수 있지만 뒤집기는 순서와 무관하고
+// 한 플레이어의 명령은 순서대로 기록되므로 다시 실행한 결과는 같음
+void journal_record(Journal *j, long tick, int player_id, char command)
+{
+    pthread_mutex_lock(&j->lock);
+    put_u32(&j->buf, (uint32_t)tick);
+    put_u16(&j->buf, player_id);
+    put_u8(&j->buf, command);
+    j->records++;
+    if (j->buf.len >= JOURNAL_FLUSH_BYTES)
+        journal_hand_off(j);
+    pthread_mutex_unlock(&j->lock);
+}
+
+void journal_close(Journal *j)
+{
+    if (j == NULL)
+        return;
+    // 쓰기 스레드가 넘겨받은 것을 다 쓰고 끝나면 남은 레코드를 직접 씀
+    pthread_mutex_lock(&j->lock);
+    j->closing = 1;
+    pthread_cond_signal(&j->cond);
+    pthread_mutex_unlock(&j->lock);
+    pthread_join(j->writer, NULL);
+    journal_write(j->fd, &j->buf);
+    close(j->fd);
+    buf_free(&j->buf);
+    buf_free(&j->out);
+    pthread_cond_destroy(&j->cond);
+    pthread_mutex_destroy(&j->lock);
+    free(j);
+}
+
+// 보드와 플레이어 위치의 해시 (실제 게임과 재생 결과 비교용)
+uint64_t game_checksum(GameInfo *game)
+{
+    uint64_t h = 1469598103934665603ULL; // FNV-1a
+    size_t cells = (size_t)game->width * game->height;
+    for (size_t i = 0; i < cells; i++)
+        h = (h ^ (unsigned char)game->board[i]) * 1099511628211ULL;
+    for (int i = 0; i < game->player_num; i++)
+    {
+        h = (h ^ (uint32_t)game->players[i].x) * 1099511628211ULL;
+        h = (h ^ (uint32_t)game->players[i].y) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// 저널을 소켓 없이 최대 속도로 다시 실행하고 결과와 걸린 시간 출력
+int journal_replay(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+        error_handling("journal open() error");
+    if (st.st_size < JOURNAL_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s: not a journal\n", path);
+        return 1;
+    }
+    const char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        error_handling("mmap() error");
+    close(fd);
+
+    Cursor c = {data, st.st_size, 4};
+    uint16_t version, width, height, player_num;
+    uint32_t seed, tile_num, play_time, tick_rate;
+    uint8_t bitplanes;
+    get_u16(&c, &version);
+    get_u32(&c, &seed);
+    get_u16(&c, &width);
+    get_u16(&c, &height);
+    get_u16(&c, &player_num);
+    get_u32(&c, &tile_num);
+    get_u32(&c, &play_time);
+    get_u32(&c, &tick_rate);
+    get_u8(&c, &bitplanes);
+    if (memcmp(data, JOURNAL_MAGIC, 4) != 0 || version != JOURNAL_VERSION || width == 0 || height == 0 ||
+        player_num == 0 || tile_num + player_num > (size_t)width * height)
+    {
+        fprintf(stderr, "%s: not a journal\n", path);
+        return 1;
+    }
+
+    GameInfo *game = malloc(sizeof(GameInfo));
+    if (game == NULL)
+        error_handling("malloc() error");
+    initialize_game(game, width, height, tile_num, play_time, player_num, bitplanes, seed);
+    game->tick_rate = tick_rate;
+
+    size_t count = (c.len - c.pos) / JOURNAL_RECORD_SIZE;
+    printf("Replaying %s: %dx%d, %d players, seed %u, %zu commands\n", path, width, height, player_num, seed, count);
+
+    long t0 = stats_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t tick;
+        uint16_t player;
+        uint8_t command;
+        get_u32(&c, &tick);
+        get_u16(&c, &player);
+        get_u8(&c, &command);
+        if (player >= player_num)
+            continue;
+
+        game->tick = tick;
+        process_player_command(command, player, game);
+        collect_dirty(game); // 실제 게임에서는 브로드캐스트가 가져감
+        clear_dirty(game);
+    }
+    long elapsed = stats_now_ns() - t0;
+
+    int red_count, blue_count;
+    calculate_tile_counts(game, &red_count, &blue_count);
+    printf("Replayed %zu commands over %ld ticks in %.3f ms (%.0f commands/s)\n", count, game->tick,
+           elapsed / 1e6, elapsed > 0 ? count * 1e9 / elapsed : 0.0);
+    printf("Red tiles: %d\nBlue tiles: %d\nChecksum: %016llx\n", red_count, blue_count,
+           (unsigned long long)game_checksum(game));
+
+    destroy_game(game);
+    munmap((void *)data, st.st_size);
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include "server.h"
+#include <poll.h>
+
+// 방 목록 (main의 accept 루프와 리액터 스레드가 함께 접근)
+static Room *rooms;
+static int live_rooms;
+static pthread_mutex_t rooms_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rooms_cond = PTHREAD_COND_INITIALIZER;
+
+// 종료된 방 통계 (방이 정리될 때 누적)
+static int finished_rooms;
+static long total_players;
+static long total_cpu_ns;
+static size_t total_memory;
+static size_t max_memory;
+
+// 새 방 생성 (main 스레드에서 호출)
+static Room *room_create(LobbyConfig *cfg, int id, int reactor_idx)
+{
+    Room *room = calloc(1, sizeof(Room));
+    GameInfo *game = malloc(sizeof(GameInfo));
+    if (room == NULL || game == NULL)
+        error_handling("malloc() error");
+
+    initialize_game(game, cfg->width, cfg->height, cfg->tile_num, cfg->play_time, cfg->player_num, cfg->use_bitplanes,
+                    cfg->seed + id);
+    game->tick_rate = cfg->tick_rate;
+    game->room = room;
+    if (cfg->journal_path)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s.%d", cfg->journal_path, id);
+        game->journal = journal_open(path, game);
+    }
+
+    room->ev_type = EV_TIMER;
+    room->id = id;
+    room->reactor_idx = reactor_idx;
+    room->game = game;
+    room->peak_memory = game_memory_footprint(game);
+    room->free_slots = malloc(cfg->player_num * sizeof(int));
+    room->left = malloc(cfg->player_num * sizeof(Connection *));
+    if (room->free_slots == NULL || room->left == NULL)
+        error_handling("malloc() error");
+
+    pthread_mutex_lock(&rooms_lock);
+    room->next = rooms;
+    rooms = room;
+    live_rooms++;
+    pthread_mutex_unlock(&rooms_lock);
+    return room;
+}
+
+// 모두 준비되면 방의 게임 시계 시작 (방을 맡은 리액터 스레드에서 호출)
+void room_start(Room *room)
+{
+    __atomic_store_n(&room->started, 1, __ATOMIC_RELEASE); // 이제 자리가 비지 않음 (run_lobby가 기다리기를 멈춤)
+    clock_start(room->game, 1);
+    reactor_watch(room->reactor_idx, room->game->clock.timer_fd, room);
+    printf("Room %d started.\n", room->id);
+}
+
+// 게임 시계가 울림, 시간이 다 되면 결과 전송 (끝난 시계는 다시 울리지 않음)
+void room_on_timer(Room *room)
+{
+    GameInfo *game = room->game;
+    if (!room->ended && clock_on_timer(game))
+    {
+        end_game(game, &room->red_count, &room->blue_count);
+        room->ended = 1;
+        printf("Room %d finished: Red %d, Blue %d", room->id, room->red_count, room->blue_count);
+        if (game->journal)
+            printf(", checksum %016llx", (unsigned long long)game_checksum(game));
+        printf("\n");
+    }
+
+    size_t bytes = game_memory_footprint(game);
+    if (bytes > room->peak_memory)
+        room->peak_memory = bytes;
+}
+
+// 방의 연결 하나가 닫힘 (방을 맡은 리액터 스레드에서 호출)
+// 시작 전에 나간 자리는 비워 다음 접속에 다시 줌 (찬 방이었으면 다시 엶, 연결 객체는 room_reap에서 해제)
+// 인원이 찬 방의 연결이 모두 닫히면 정리 대상으로 표시 -> 이벤트 배치가 끝난 뒤 room_reap에서 해제
+void room_conn_closed(Room *room, Connection *conn, int waiting)
+{
+    pthread_mutex_lock(&rooms_lock);
+    room->open_conns--;
+    if (waiting)
+    { // conn_close가 연결 목록에서 이미 뺐음 -> main이 같은 자리에 새 연결을 넣어도 됨
+        room->left[room->left_num++] = conn;
+        room->free_slots[room->free_num++] = conn->p_num;
+        room->joined--;
+        room->full = 0;
+        printf("Room %d: player %d left, slot reopened.\n", room->id, conn->p_num);
+    }
+    else if (room->open_conns == 0 && room->full)
+    {
+        room->dead = 1;
+    }
+    pthread_mutex_unlock(&rooms_lock);
+}
+
+// 자리를 비운 연결 해제 (rooms_lock 보유, 방을 맡은 리액터 스레드에서 이벤트 배치가 끝난 뒤 호출)
+static void room_free_left(Room *room)
+{
+    for (int i = 0; i < room->left_num; i++)
+        conn_destroy(room->left[i]);
+    room->left_num = 0;
+}
+
+// 시작 전에 자리가 빈 방 중 가장 먼저 만든 방 (rooms_lock 보유 상태에서 호출, 없으면 NULL)
+static Room *reopened_room(void)
+{
+    Room *found = NULL;
+    for (Room *room = rooms; room; room = room->next)
+    {
+        if (!room->full && room->free_num > 0)
+            found = room; // 목록은 최근 방부터 -> 마지막으로 찾은 방이 가장 오래됨
+    }
+    return found;
+}
+
+// 아직 시작하지 않은 방 수 (rooms_lock 보유 상태에서 호출)
+static int unstarted_rooms(void)
+{
+    int count = 0;
+    for (Room *room = rooms; room; room = room->next)
+        count += !__atomic_load_n(&room->started, __ATOMIC_ACQUIRE);
+    return count;
+}
+
+static double ns_to_ms(long ns)
+{
+    return ns / 1000000.0;
+}
+
+// 이 리액터가 맡은 방 중 끝난 방을 해제하고 사용량 보고
+void room_reap(int reactor_idx)
+{
+    Room *done = NULL;
+
+    pthread_mutex_lock(&rooms_lock);
+    for (Room **pp = &rooms; *pp;)
+    {
+        Room *room = *pp;
+        if (room->reactor_idx == reactor_idx)
+            room_free_left(room);
+        if (room->dead && room->reactor_idx == reactor_idx)
+        {
+            *pp = room->next;
+            room->next = done;
+            done = room;
+        }
+        else
+        {
+            pp = &room->next;
+        }
+    }
+    pthread_mutex_unlock(&rooms_lock);
+
+    while (done)
+    {
+        Room *room = done;
+        done = room->next;
+
+        GameInfo *game = room->game;
+        double duration = 0;
+        if (game->clock.timer_fd >= 0)
+        {
+            duration = (stats_now_ns() - game->clock.start_ns) / 1e9;
+            reactor_unwatch(room->reactor_idx, game->clock.timer_fd);
+        }
+        printf("Room %d closed: %d players, %.1f s, %ld ticks, peak memory %zu bytes, cpu %.3f ms\n",
+               room->id, room->joined, duration, game->tick, room->peak_memory, ns_to_ms(room->cpu_ns));
+
+        destroy_game(room->game);
+        free(room->free_slots);
+        free(room->left);
+
+        pthread_mutex_lock(&rooms_lock);
+        finished_rooms++;
+        total_players += room->joined;
+        total_cpu_ns += room->cpu_ns;
+        total_memory += room->peak_memory;
+        if (room->peak_memory > max_memory)
+            max_memory = room->peak_memory;
+        if (--live_rooms == 0)
+            pthread_cond_broadcast(&rooms_cond);
+        pthread_mutex_unlock(&rooms_lock);
+
+        free(room);
+    }
+}
+
+// 방 모드 accept 루프: 접속 순서대로 방을 채우고, 찬 방은 리액터에 맡긴 채 다음 방을 엶
+// 시작 전에 누가 나가 자리가 빈 방이 있으면 그 방부터 채움
+// max_rooms개의 방이 모두 끝나면 반환 (0이면 계속 실행)
+void run_lobby(int serv_sd, LobbyConfig *cfg)
+{
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_size;
+    Room *filling = NULL;
+    int room_count = 0;
+
+    while (1)
+    {
+        if (filling == NULL && cfg->max_rooms > 0 && room_count == cfg->max_rooms)
+        {
+            // 마지막 방까지 찼어도 시작 전에 자리가 다시 빌 수 있음 -> 모든 방이 시작할 때까지 지켜봄
+            pthread_mutex_lock(&rooms_lock);
+            int reopened = reopened_room() != NULL;
+            int unstarted = unstarted_rooms();
+            pthread_mutex_unlock(&rooms_lock);
+            if (unstarted == 0)
+                break;
+            if (!reopened)
+            { // 빈자리가 생길 때까지 새 접속은 대기열에 둠
+                poll(NULL, 0, LOBBY_POLL_MS);
+                continue;
+            }
+        }
+        else if (filling == NULL)
+        {
+            // 방마다 리액터 하나가 전담 -> 한 방의 처리는 한 스레드에서만 일어남
+            filling = room_create(cfg, room_count, room_count % reactor_total());
+            room_count++;
+        }
+
+        client_addr_size = sizeof(client_addr);
+        int clnt_sd = accept(serv_sd, (struct sockaddr *)&client_addr, &client_addr_size);
+        if (clnt_sd < 0)
+            error_handling("accept() error");
+
+        pthread_mutex_lock(&rooms_lock);
+        Room *room = reopened_room(); // 빈자리는 main만 채움 -> 위에서 본 빈자리가 그대로 있음
+        if (room == NULL)
+            room = filling;
+        int p_num = room->free_num > 0 ? room->free_slots[--room->free_num] : room->joined;
+        room->joined++;
+        room->open_conns++;
+        room->full = room->joined == cfg->player_num;
+        pthread_mutex_unlock(&rooms_lock);
+
+        printf("Room %d: player %d has connected.\n", room->id, p_num);
+        reactor_add_client(room->game, clnt_sd, p_num);
+        if (room == filling && room->full)
+            filling = NULL;
+    }
+
+    // 진행 중인 방이 모두 끝날 때까지 대기
+    pthread_mutex_lock(&rooms_lock);
+    while (live_rooms > 0)
+        pthread_cond_wait(&rooms_cond, &rooms_lock);
+    pthread_mutex_unlock(&rooms_lock);
+
+    if (finished_rooms > 0)
+    {
+        printf("\nRooms: %d, players: %ld\n", finished_rooms, total_players);
+        printf("CPU: total %.3f ms, %.3f ms per room\n", ns_to_ms(total_cpu_ns), ns_to_ms(total_cpu_ns) / finished_rooms);
+        printf("Memory: %zu bytes per room, max %zu bytes\n", total_memory / finished_rooms, max_memory);
+    }
+}
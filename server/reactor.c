@@ -0,0 +1,386 @@
+#include "server.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#define MAX_EVENTS 256 // epoll_wait 한 번에 처리할 최대 이벤트 수
+
+typedef struct
+{
+    int index;        // 리액터 번호
+    int epfd;         // epoll 인스턴스
+    int wake_fd;      // 종료 알림용 eventfd
+    int running;      // 루프 계속 여부
+    pthread_t thread; // 리액터 스레드
+} Reactor;
+
+static Reactor *reactors;
+static int reactor_count;
+
+// 열린 연결 수 (모두 닫힐 때까지 main이 대기)
+static int active_conns;
+static pthread_mutex_t active_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t active_cond = PTHREAD_COND_INITIALIZER;
+
+// 연결 종료 (소속 리액터 스레드에서만 호출)
+static void conn_close(Connection *conn, const char *reason)
+{
+    GameInfo *game = conn->game;
+
+    if (conn->spectator)
+    { // 관전자: 게임 상태에 남긴 것이 없음 (연결 객체는 게임이 끝날 때 해제)
+        conn_shutdown(conn);
+        return;
+    }
+
+    if (reason)
+        printf("Client %d %s.\n", conn->p_num, reason);
+
+    int waiting = conn->state == CONN_HANDSHAKE; // 게임 시작 전에 나감
+    game_lock(game);
+    if (waiting && game->players[conn->p_num].ready)
+        game->players_ready--; // 준비했다가 나간 플레이어는 준비 인원에서 뺌
+    game->players[conn->p_num].ready = 0; // clnt 준비되지 않음으로 설정
+    game->players[conn->p_num].clnt_sd = -1;
+    if (waiting && game->room)
+        game->conns[conn->p_num] = NULL; // 방 모드는 자리를 다시 내줌 -> 연결 객체는 방이 해제
+    game_unlock(game);
+
+    conn_shutdown(conn);
+    if (game->room)
+        room_conn_closed(game->room, conn, waiting);
+
+    pthread_mutex_lock(&active_lock);
+    if (--active_conns == 0)
+        pthread_cond_broadcast(&active_cond);
+    pthread_mutex_unlock(&active_lock);
+}
+
+// 모든 플레이어가 준비되면 각자에게 자기 관심 영역의 초기 키프레임 전송 (game->lock 보유 상태에서 호출)
+static void start_game(GameInfo *game)
+{
+    for (int i = 0; i < game->player_num; i++)
+    {
+        Connection *conn = game->conns[i];
+        if (conn && game->players[i].ready && conn->state == CONN_HANDSHAKE)
+        {
+            conn->state = CONN_PLAYING;
+            send_game_info(game, i);
+        }
+    }
+
+    // 방 모드: 모두 준비된 시점부터 방의 게임 시계 시작 (단일 게임은 main이 start_cond로 기다렸다가 시작)
+    if (game->room)
+        room_start(game->room);
+    else
+        pthread_cond_broadcast(&game->start_cond);
+}
+
+// 마지막 자리를 봇이 채워 모두 준비됨 (game->lock 보유 상태에서 main이 호출)
+void reactor_start_game(GameInfo *game)
+{
+    start_game(game);
+}
+
+// 핸드셰이크 한 바이트 처리 (game->lock 보유 상태에서 호출)
+static void conn_handshake(Connection *conn, char command)
+{
+    GameInfo *game = conn->game;
+
+    if (conn->state != CONN_HANDSHAKE)
+        return; // lock을 기다리는 사이 다른 리액터가 게임을 시작함 -> 명령 전 바이트는 무시
+    if (command == HANDSHAKE_COMPRESS)
+        conn->compress = 1; // 키프레임 압축 요청
+    else if (command == HANDSHAKE_UDP)
+        udp_offer(game, conn); // UDP 채널이 없으면 무시
+    else if (command == 'y' && conn->spectator)
+        spectator_join(game, conn);
+    else if (command == 'y' && !game->players[conn->p_num].ready)
+    { // 준비 완료 명령 처리
+        game->players[conn->p_num].ready = 1;
+        printf("Client %d is ready.\n", conn->p_num);
+        game->players_ready++;
+        if (game->players_ready == game->player_num)
+            start_game(game);
+    }
+}
+
+// 게임 중이 아닐 때 받은 한 바이트 처리 (게임 중 명령은 conn_read가 한꺼번에 처리)
+// 반환값: 1이면 연결을 닫아야 함
+static int conn_command(Connection *conn, char command)
+{
+    GameInfo *game = conn->game;
+
+    if (conn->state == CONN_HANDSHAKE)
+    {
+        game_lock(game);
+        conn_handshake(conn, command);
+        game_unlock(game);
+        return 0;
+    }
+
+    if (conn->spectator)
+    { // 관전자는 명령을 보낼 수 없음 (게임 종료 후 종료 확인만)
+        return game_ended(game) && command == 'q';
+    }
+
+    // 게임 종료 후 종료 확인 메시지
+    if (game_ended(game) && command == 'q')
+    {
+        printf("Client %d game end.\n", conn->p_num);
+        return 1;
+    }
+    return 0;
+}
+
+// 읽을 수 있는 데이터를 모두 읽어 처리
+static void conn_read(Connection *conn)
+{
+    char buffer[256];
+
+    while (1)
+    {
+        ssize_t n = read(conn->fd, buffer, sizeof(buffer));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+        }
+        if (n <= 0)
+        {
+            conn_close(conn, conn->state == CONN_HANDSHAKE ? "disconnected" : "disconnected during game");
+            return;
+        }
+
+        // 게임 중: 읽은 명령을 모두 적용하고 브로드캐스트는 한 번
+        if (conn->state == CONN_PLAYING && !conn->spectator && !game_ended(conn->game))
+        {
+            submit_commands(conn->game, conn->p_num, buffer, n);
+            continue;
+        }
+
+        int quit = 0;
+        for (ssize_t i = 0; i < n && !quit; i++)
+        {
+            quit = conn_command(conn, buffer[i]);
+        }
+
+        if (quit)
+        {
+            conn_close(conn, NULL);
+            return;
+        }
+    }
+}
+
+static long elapsed_ns(struct timespec *t0, struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1000000000L + (t1->tv_nsec - t0->tv_nsec);
+}
+
+static void *reactor_loop(void *arg)
+{
+    Reactor *r = arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (r->running)
+    {
+        int n = epoll_wait(r->epfd, events, MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            error_handling("epoll_wait() error");
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            int *ev_type = events[i].data.ptr;
+            if (ev_type == NULL)
+            { // 종료 알림
+                uint64_t v;
+                read(r->wake_fd, &v, sizeof(v));
+                continue;
+            }
+
+            // 방 모드: 이벤트 처리에 든 스레드 CPU 시간을 방에 청구
+            Room *room = NULL;
+            if (*ev_type == EV_TIMER)
+                room = (Room *)ev_type;
+            else if (*ev_type == EV_CONN)
+                room = ((Connection *)ev_type)->game->room;
+            struct timespec t0, t1;
+            if (room)
+                clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+
+            if (*ev_type == EV_TIMER)
+            {
+                room_on_timer(room);
+            }
+            else if (*ev_type == EV_UDP)
+            {
+                udp_on_read((UdpChannel *)ev_type);
+            }
+            else
+            {
+                Connection *conn = (Connection *)ev_type;
+                if (conn->state == CONN_CLOSED)
+                    continue;
+
+                if (events[i].events & EPOLLOUT)
+                {
+                    pthread_mutex_lock(&conn->out_lock);
+                    if (conn->state != CONN_CLOSED)
+                        conn_flush(conn);
+                    pthread_mutex_unlock(&conn->out_lock);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    conn_read(conn);
+            }
+
+            if (room)
+            {
+                clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+                room->cpu_ns += elapsed_ns(&t0, &t1);
+            }
+        }
+
+        // 이번 배치의 이벤트가 더 이상 참조하지 않으므로 끝난 방 정리
+        room_reap(r->index);
+    }
+    return NULL;
+}
+
+// 리액터 스레드 생성
+void reactor_start(int reactor_num)
+{
+    // 많은 소켓을 열 수 있도록 fd 한도를 최대로
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    reactor_count = reactor_num;
+    reactors = calloc(reactor_num, sizeof(Reactor));
+    for (int i = 0; i < reactor_num; i++)
+    {
+        Reactor *r = &reactors[i];
+        r->index = i;
+        r->epfd = epoll_create1(0);
+        r->wake_fd = eventfd(0, EFD_NONBLOCK);
+        if (r->epfd < 0 || r->wake_fd < 0)
+            error_handling("epoll_create1() error");
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->wake_fd, &ev);
+
+        r->running = 1;
+        if (pthread_create(&r->thread, NULL, reactor_loop, r) != 0)
+            error_handling("pthread_create() error");
+    }
+}
+
+// 새 클라이언트 소켓을 리액터에 등록하고 플레이어 ID 전송
+void reactor_add_client(GameInfo *game, int clnt_sd, int p_num)
+{
+    // 방 모드면 방을 맡은 리액터, 아니면 플레이어별로 분산
+    int idx = game->room ? game->room->reactor_idx : p_num % reactor_count;
+    Connection *conn = conn_create(game, clnt_sd, p_num, reactors[idx].epfd);
+    Buffer buf = {0};
+    encode_player_id(&buf, p_num);
+
+    pthread_mutex_lock(&active_lock);
+    active_conns++;
+    pthread_mutex_unlock(&active_lock);
+
+    // 리액터가 'y'를 처리하려면 game->lock이 필요 -> lock을 잡은 채 등록하고 ID를 먼저 큐에 넣음
+    game_lock(game);
+    game->conns[p_num] = conn;
+    game->players[p_num].clnt_sd = clnt_sd; // clnt_sd 저장
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    if (epoll_ctl(conn->epfd, EPOLL_CTL_ADD, clnt_sd, &ev) < 0)
+        error_handling("epoll_ctl() error");
+    conn_send(conn, buf.data, buf.len, OUT_CONTROL);
+    game_unlock(game);
+
+    buf_free(&buf);
+}
+
+// 관전자 소켓을 리액터에 등록 ('y'를 받으면 관전 시작, 플레이어 ID는 없음)
+// 플레이어 연결 수에는 넣지 않음 -> 게임이 끝나면 관전자를 기다리지 않고 종료
+void reactor_add_spectator(GameInfo *game, int clnt_sd)
+{
+    static int next;
+    int idx = next++ % reactor_count; // 관전자 스레드에서만 호출
+    Connection *conn = conn_create(game, clnt_sd, -1, reactors[idx].epfd);
+    conn->spectator = 1;
+
+    game_lock(game);
+    spectator_add(game, conn);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    if (epoll_ctl(conn->epfd, EPOLL_CTL_ADD, clnt_sd, &ev) < 0)
+        error_handling("epoll_ctl() error");
+    game_unlock(game);
+}
+
+// 모든 연결이 닫힐 때까지 대기
+void reactor_wait_closed(void)
+{
+    pthread_mutex_lock(&active_lock);
+    while (active_conns > 0)
+        pthread_cond_wait(&active_cond, &active_lock);
+    pthread_mutex_unlock(&active_lock);
+}
+
+// 리액터 스레드 종료 및 정리
+void reactor_stop(void)
+{
+    for (int i = 0; i < reactor_count; i++)
+    {
+        uint64_t v = 1;
+        reactors[i].running = 0;
+        write(reactors[i].wake_fd, &v, sizeof(v));
+    }
+    for (int i = 0; i < reactor_count; i++)
+    {
+        pthread_join(reactors[i].thread, NULL);
+        close(reactors[i].epfd);
+        close(reactors[i].wake_fd);
+    }
+    free(reactors);
+    reactors = NULL;
+    reactor_count = 0;
+}
+
+int reactor_total(void)
+{
+    return reactor_count;
+}
+
+// 리액터 epoll에 fd 등록 (ptr는 EV_* 태그로 시작하는 구조체)
+void reactor_watch(int reactor_idx, int fd, void *ptr)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = ptr;
+    if (epoll_ctl(reactors[reactor_idx].epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        error_handling("epoll_ctl() error");
+}
+
+void reactor_unwatch(int reactor_idx, int fd)
+{
+    epoll_ctl(reactors[reactor_idx].epfd, EPOLL_CTL_DEL, fd, NULL);
+}
@@ -1,21 +1,269 @@
 #include "server.h"
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
 
-// 게임 정보 -> clnt 전송
-void send_game_info(int clnt_sd, GameInfo *game)
+// 플레이어 ID 직렬화
+void encode_player_id(Buffer *buf, int p_num)
 {
-    write(clnt_sd, &game->play_time, sizeof(game->play_time));
-    write(clnt_sd, &game->width, sizeof(game->width));
-    write(clnt_sd, &game->height, sizeof(game->height));
-    write(clnt_sd, &game->player_num, sizeof(game->player_num));
+    size_t start = frame_begin(buf, MSG_PLAYER_ID, 0);
+    put_u32(buf, p_num);
+    frame_end(buf, start);
+}
+
+static int in_view(View *view, int x, int y)
+{
+    return x >= view->x && x < view->x + view->w && y >= view->y && y < view->y + view->h;
+}
+
+// 플레이어 위치 읽기 (명령 스레드가 lock 없이 바꾸므로 원자적으로)
+static void player_pos(Player *p, int *x, int *y)
+{
+    *x = __atomic_load_n(&p->x, __ATOMIC_RELAXED);
+    *y = __atomic_load_n(&p->y, __ATOMIC_RELAXED);
+}
+
+static int player_in_view(View *view, Player *p)
+{
+    int x, y;
+    player_pos(p, &x, &y);
+    return in_view(view, x, y);
+}
+
+// 플레이어의 공개 필드만 레코드로 (clnt_sd, ready는 보내지 않음)
+static void encode_player(Buffer *buf, GameInfo *game, int p_num)
+{
+    Player *p = &game->players[p_num];
+    PlayerUpdate rec = {p_num, p->team, 0, 0, __atomic_load_n(&p->ack, __ATOMIC_ACQUIRE)};
+    player_pos(p, &rec.x, &rec.y);
+    encode_player_record(buf, &rec);
+}
+
+// 게임 정보(키프레임) 직렬화 -> 관심 영역의 셀과 그 안의 플레이어만
+void encode_game_info(Buffer *buf, GameInfo *game, View *view)
+{
+    size_t start = frame_begin(buf, MSG_KEYFRAME, game->seq);
+    KeyframeHeader h = {{game->play_time, game->red_count, game->blue_count},
+                        game->width, game->height, game->player_num, *view};
+    encode_keyframe_header(buf, &h);
+
+    // 영역 안의 보드 (셀당 2비트)
+    encode_cells(buf, &CELL(game, view->x, view->y), game->width, view->w, view->h);
+
+    // 영역 안의 플레이어 정보
+    size_t count_at = buf->len;
+    uint32_t count = 0;
+    put_u32(buf, 0);
+    for (int i = 0; i < game->player_num; i++)
+    {
+        if (player_in_view(view, &game->players[i]))
+        {
+            encode_player(buf, game, i);
+            count++;
+        }
+    }
+    patch_u32(buf, count_at, count);
+    frame_end(buf, start);
+}
+
+// 직전 브로드캐스트 이후 관심 영역에서 바뀐 셀과 플레이어 위치만 직렬화
+void encode_game_delta(Buffer *buf, GameInfo *game, View *view)
+{
+    size_t start = frame_begin(buf, MSG_DELTA, game->seq);
+    StateHeader h = {game->play_time, game->red_count, game->blue_count};
+    encode_state_header(buf, &h);
+
+    size_t count_at = buf->len;
+    uint32_t count = 0;
+    put_u32(buf, 0);
+    for (int i = 0; i < game->dirty_count; i++)
+    {
+        size_t idx = game->dirty_cells[i];
+        char tile = __atomic_load_n(&game->board[idx], __ATOMIC_RELAXED); // 명령 스레드가 CAS로 바꾸는 중일 수 있음
+        CellUpdate cell = {(int)(idx % game->width), (int)(idx / game->width), tile};
+        if (in_view(view, cell.x, cell.y))
+        {
+            encode_cell_update(buf, &cell);
+            count++;
+        }
+    }
+    patch_u32(buf, count_at, count);
+
+    // 이동은 한 칸씩이므로 영역을 한 칸 넓혀서 보면 영역 밖으로 나간 이동도 포함됨
+    View near = {view->x - 1, view->y - 1, view->w + 2, view->h + 2};
+    count_at = buf->len;
+    count = 0;
+    put_u32(buf, 0);
+    for (int i = 0; i < game->player_num; i++)
+    {
+        if (game->player_dirty[i] && player_in_view(&near, &game->players[i]))
+        {
+            encode_player(buf, game, i);
+            count++;
+        }
+    }
+    patch_u32(buf, count_at, count);
+    frame_end(buf, start);
+}
+
+// 게임 결과(타일 수, 승자) 직렬화
+void encode_tile_counts(Buffer *buf, GameInfo *game, int red_count, int blue_count, char winner)
+{
+    size_t start = frame_begin(buf, MSG_RESULT, game->seq);
+    GameResult result = {red_count, blue_count, winner};
+    encode_game_result(buf, &result);
+    frame_end(buf, start);
+}
+
+// 게임 정보(키프레임) -> 플레이어 전송
+void send_game_info(GameInfo *game, int p_num)
+{
+    Buffer buf = {0};
+    FanoutFrame frame = {0};
+    view_follow(game, p_num);
+    encode_game_info(&buf, game, &game->views[p_num]);
+    fanout_set(&frame, &buf);
+    fanout_send(&frame, game->conns[p_num], OUT_KEYFRAME);
+    fanout_release(&frame);
+}
+
+// 관전자 연결 등록 (game->lock 보유 상태에서 호출, 'y'를 받기 전까지는 아무것도 보내지 않음)
+void spectator_add(GameInfo *game, Connection *conn)
+{
+    if (game->spectator_num == game->spectator_cap)
+    {
+        game->spectator_cap = game->spectator_cap ? game->spectator_cap * 2 : 16;
+        game->spectators = realloc(game->spectators, game->spectator_cap * sizeof(Connection *));
+        if (game->spectators == NULL)
+            error_handling("realloc() error");
+    }
+    game->spectators[game->spectator_num++] = conn;
+}
+
+// 관전 시작: 보드 전체 키프레임 전송 (game->lock 보유 상태에서 호출)
+// 다음 브로드캐스트부터 다른 관전자와 같은 프레임을 받음
+void spectator_join(GameInfo *game, Connection *conn)
+{
+    View all = {0, 0, game->width, game->height};
+    Buffer buf = {0};
+    FanoutFrame frame = {0};
+
+    conn->state = CONN_PLAYING;
+    encode_game_info(&buf, game, &all);
+    fanout_set(&frame, &buf);
+    fanout_send(&frame, conn, OUT_KEYFRAME);
+    fanout_release(&frame);
+}
+
+// 직렬화를 마친 buf를 공유 프레임으로 (이전 프레임과 압축본은 놓음)
+void fanout_set(FanoutFrame *frame, Buffer *buf)
+{
+    fanout_release(frame);
+    frame->plain = shared_wrap(buf);
+    stats_count(ST_ENCODES, 1);
+}
+
+// 공유 프레임을 연결 하나의 송신 큐에 추가 (복사 없이 참조만)
+// 압축을 요청한 연결에 키프레임을 보낼 때는 압축본을 처음 한 번만 만들어 이후 연결과 나눠 씀
+int fanout_send(FanoutFrame *frame, Connection *conn, int kind)
+{
+    if (kind != OUT_KEYFRAME || !conn->compress)
+        return conn_send_shared(conn, frame->plain, kind);
+
+    if (frame->packed == NULL)
+    {
+        Buffer packed = {0};
+        long t0 = stats_now_ns();
+        frame_compress(&packed, frame->plain->data, frame->plain->len);
+        stats_record(ST_KF_COMPRESS, stats_now_ns() - t0);
+        stats_record(ST_KF_RATIO, packed.len * 100 / frame->plain->len);
+        stats_count(ST_KF_RAW, frame->plain->len);
+        stats_count(ST_KF_PACKED, packed.len);
+        frame->packed = shared_wrap(&packed);
+    }
+    return conn_send_shared(conn, frame->packed, kind);
+}
+
+void fanout_release(FanoutFrame *frame)
+{
+    shared_release(frame->plain);
+    shared_release(frame->packed);
+    frame->plain = frame->packed = NULL;
+}
+
+// 셀 변경 기록 (다음 델타에 포함, 셀 값을 바꾼 뒤 호출, lock 없음)
+// 이미 표시돼 있으면 아직 가져가지 않은 브로드캐스트가 최신 값을 읽으므로 바로 끝남
+// 표시를 CAS로 처음 건 스레드만 링의 자리 하나를 받아 씀 -> 표시된 셀(타일)보다 많이 쌓이지 않음
+void mark_cell_dirty(GameInfo *game, int x, int y)
+{
+    size_t idx = (size_t)y * game->width + x;
+    char clean = 0;
+    if (__atomic_load_n(&game->cell_dirty[idx], __ATOMIC_RELAXED) ||
+        !__atomic_compare_exchange_n(&game->cell_dirty[idx], &clean, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return;
+
+    unsigned long slot = __atomic_fetch_add(&game->changed_tail, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&game->changed_cells[slot & (game->changed_cap - 1)], idx + 1, __ATOMIC_RELEASE);
+}
+
+static int clamp(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// 플레이어가 관심 영역 가장자리에 다가가면 플레이어를 가운데로 영역을 옮김
+// 반환값: 1이면 영역이 바뀜 -> 새 영역의 키프레임을 보내야 함
+int view_follow(GameInfo *game, int p_num)
+{
+    View *view = &game->views[p_num];
+    int px, py;
+    int x = view->x, y = view->y;
+
+    player_pos(&game->players[p_num], &px, &py);
+    if (px < view->x + VIEW_MARGIN || px >= view->x + view->w - VIEW_MARGIN)
+        x = clamp(px - view->w / 2, 0, game->width - view->w);
+    if (py < view->y + VIEW_MARGIN || py >= view->y + view->h - VIEW_MARGIN)
+        y = clamp(py - view->h / 2, 0, game->height - view->h);
+
+    if (x == view->x && y == view->y)
+        return 0;
+    view->x = x;
+    view->y = y;
+    return 1;
+}
 
-    // 보드의 각 행에 대한 정보 전송
-    for (int i = 0; i < game->height; i++)
+// 명령이 남긴 변경을 이번 브로드캐스트 몫으로 가져옴 (game->lock 보유 상태에서 호출)
+// 표시를 먼저 지우고 값은 직렬화할 때 읽음 -> 그 사이에 바뀐 것은 다음 브로드캐스트에 다시 들어감
+// 자리를 받고 아직 쓰지 않은 명령 스레드가 있으면 (몇 명령어 사이) 쓸 때까지 기다림
+void collect_dirty(GameInfo *game)
+{
+    unsigned long tail = __atomic_load_n(&game->changed_tail, __ATOMIC_SEQ_CST);
+    size_t mask = game->changed_cap - 1;
+    game->dirty_count = 0;
+    for (unsigned long i = game->changed_head; i != tail; i++)
     {
-        write(clnt_sd, game->board[i], game->width);
+        size_t *entry = &game->changed_cells[i & mask];
+        size_t cell;
+        while ((cell = __atomic_load_n(entry, __ATOMIC_ACQUIRE)) == 0)
+            sched_yield();
+        __atomic_store_n(entry, 0, __ATOMIC_RELAXED);
+        game->dirty_cells[game->dirty_count++] = cell - 1;
+        __atomic_store_n(&game->cell_dirty[cell - 1], 0, __ATOMIC_SEQ_CST);
     }
+    game->changed_head = tail;
 
-    // 모든 플레이어 정보 -> clnt 전송
-    write(clnt_sd, game->players, game->player_num * sizeof(Player));
+    for (int i = 0; i < game->player_num; i++)
+    {
+        game->player_dirty[i] = __atomic_exchange_n(&game->player_moved[i], 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+// 변경 기록 초기화 (브로드캐스트 후)
+void clear_dirty(GameInfo *game)
+{
+    game->dirty_count = 0;
+    memset(game->player_dirty, 0, game->player_num);
 }
 
 void error_handling(char *message)
@@ -25,63 +273,158 @@ void error_handling(char *message)
     exit(1);
 }
 
-// 게임 설정 초기화
-void initialize_game(GameInfo *game, int width, int height, int tile_num, int play_time, int player_num)
+// 배치용 난수 (splitmix64, 시드가 같으면 같은 수열)
+static uint64_t rng_next(uint64_t *state)
 {
-    game->width = width;
-    game->height = height;
-    game->tile_num = tile_num;
-    game->play_time = play_time;
-    game->players_ready = 0;
-    game->player_num = player_num;
-    game->board = malloc(height * sizeof(char *)); // 보드 메모리 할당
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
 
-    // 보드의 각 행 mem allocate & initialize
-    for (int i = 0; i < height; i++)
+// 0 이상 n 미만의 고른 난수 (곱셈 후 상위 비트, 치우친 구간은 다시 뽑음)
+// 나눗셈은 다시 뽑아야 할 수도 있는 드문 경우에만
+static size_t rng_below(uint64_t *state, size_t n)
+{
+    __uint128_t m = (__uint128_t)rng_next(state) * n;
+    if ((uint64_t)m < n)
     {
-        game->board[i] = malloc(width);
-        memset(game->board[i], ' ', width); // 보드 초기화
+        uint64_t threshold = -(uint64_t)n % n;
+        while ((uint64_t)m < threshold)
+            m = (__uint128_t)rng_next(state) * n;
     }
+    return (size_t)(m >> 64);
+}
 
-    // 타일을 보드에 배치
-    int red_tiles = tile_num / 2;
-    int blue_tiles = tile_num - red_tiles;
-    for (int i = 0; i < red_tiles + blue_tiles; i++)
+// 배치 순번 slot의 칸 채우기: 앞에서부터 RED 타일, BLUE 타일, 플레이어 순
+static void place_slot(GameInfo *game, int x, int y, size_t slot)
+{
+    if (slot < (size_t)game->tile_num)
     {
-        int x, y;
+        board_set(game, x, y, slot < (size_t)game->tile_num / 2 ? 'R' : 'B');
+        return;
+    }
+    Player *p = &game->players[slot - game->tile_num];
+    p->x = x;
+    p->y = y;
+}
 
-        // 보드에서 비어있는 위치(' ')를 찾을 때까지 계속 반복
-        do
-        {
-            // 보드의 너비와 높이 내에서 랜덤한 값을 가짐
-            x = rand() % width;
-            y = rand() % height;
-        } while (game->board[y][x] != ' '); // 해당 위치가 비어있지 않으면 -> 다시 랜덤 위치 찾기
+// 보드 칸 중 서로 다른 k개를 뽑아 무작위 순번으로 배치 (Floyd 표본 추출 후 섞기, O(k))
+// 뽑았는지는 cell_dirty에 잠시 표시했다가 되돌림 -> 보드 크기와 무관하게 추가 메모리는 k개
+static void place_sparse(GameInfo *game, size_t k, uint64_t *rng)
+{
+    size_t n = (size_t)game->width * game->height;
+    size_t *picked = malloc(k * sizeof(size_t));
+    if (picked == NULL)
+        error_handling("malloc() error");
 
-        game->board[y][x] = (i < red_tiles) ? 'R' : 'B'; // 타일 배치
+    for (size_t j = n - k, i = 0; j < n; j++, i++)
+    {
+        size_t t = rng_below(rng, j + 1);
+        if (game->cell_dirty[t])
+            t = j; // t는 이미 뽑혔고 j는 아직 후보가 된 적 없음
+        game->cell_dirty[t] = 1;
+        picked[i] = t;
+    }
+    for (size_t i = k - 1; i > 0; i--)
+    {
+        size_t j = rng_below(rng, i + 1);
+        size_t tmp = picked[i];
+        picked[i] = picked[j];
+        picked[j] = tmp;
+    }
+    for (size_t i = 0; i < k; i++)
+    {
+        game->cell_dirty[picked[i]] = 0;
+        place_slot(game, picked[i] % game->width, picked[i] / game->width, i);
     }
+    free(picked);
+}
 
-    // 플레이어를 보드에 배치
-    game->players = malloc(player_num * sizeof(Player));
-    for (int i = 0; i < player_num; i++)
+// 보드를 앞에서부터 한 번 훑으며 남은 칸 중 남은 개수의 비율로 뽑음 (선택 표본 추출, 칸마다 난수 하나)
+// 뽑힌 칸은 남은 순번 중 하나를 고르게 받음 -> 타일 색은 남은 개수로, 플레이어는 끝에서 섞음
+static void place_dense(GameInfo *game, size_t k, uint64_t *rng)
+{
+    size_t n = (size_t)game->width * game->height;
+    size_t red_left = game->tile_num / 2;
+    size_t blue_left = game->tile_num - red_left;
+    size_t player_slot = game->tile_num;
+
+    for (int x = 0, y = 0; k > 0; n--)
     {
-        int x, y;
-        do
+        size_t r = rng_below(rng, n); // r < k면 뽑힘, 이때 r은 남은 k개 순번 중 고른 하나
+        if (r < k)
         {
-            x = rand() % width;
-            y = rand() % height;
-        } while (game->board[y][x] != ' '); // 비어있는 위치 찾기
-
-        game->players[i].player_id = i;
-        game->players[i].x = x;
-        game->players[i].y = y;
-        // index 짝수: RED & 홀수: BLUE
-        game->players[i].team = (i % 2 == 0) ? 'R' : 'B';
-        // 플레이어의 clnt_sd 초기화 = 아직 클라이언트와 연결되지 않았음을 나타냄
-        game->players[i].clnt_sd = -1;
-        // 플레이어의 준비 상태를 0으로 초기화 = 준비되지 않은 상태를 나타냄 (y 누르기전)
-        game->players[i].ready = 0;
+            k--;
+            if (r < red_left)
+                place_slot(game, x, y, red_left-- - 1);
+            else if (r < red_left + blue_left)
+                place_slot(game, x, y, game->tile_num / 2 + blue_left-- - 1);
+            else
+                place_slot(game, x, y, player_slot++);
+        }
+        if (++x == game->width)
+        {
+            x = 0;
+            y++;
+        }
     }
+    // 플레이어는 훑은 순서대로 자리를 받았으므로 자리를 섞음 (팀은 번호로 정해져 있음)
+    for (int i = game->player_num - 1; i > 0; i--)
+    {
+        Player *a = &game->players[i], *b = &game->players[rng_below(rng, i + 1)];
+        int x = a->x, y = a->y;
+        a->x = b->x;
+        a->y = b->y;
+        b->x = x;
+        b->y = y;
+    }
+}
+
+// 보드와 플레이어를 뺀 게임 상태 초기화
+static void init_game_state(GameInfo *game, int width, int height, int tile_num, int play_time, int player_num, unsigned int seed)
+{
+    game->width = width;
+    game->height = height;
+    game->tile_num = tile_num;
+    game->play_time = play_time;
+    game->ended = 0;
+    game->inflight = 0;
+    game->clock.timer_fd = -1;
+    game->players_ready = 0;
+    game->player_num = player_num;
+    game->seq = 0;
+    game->since_keyframe = 0;
+    game->dirty_cells = NULL;
+    game->dirty_count = 0;
+    game->changed_cells = NULL;
+    game->changed_head = 0;
+    game->changed_tail = 0;
+    game->changed_cap = 0;
+    game->cell_dirty = calloc((size_t)width * height, 1);
+    game->player_dirty = calloc(player_num, 1);
+    game->player_moved = calloc(player_num, 1);
+    game->bcast_pending = 0;
+    game->broadcasting = 0;
+    game->conns = calloc(player_num, sizeof(Connection *));
+    game->tick_rate = 0;
+    game->room = NULL;
+    game->spectators = NULL;
+    game->spectator_num = 0;
+    game->spectator_cap = 0;
+    game->seed = seed;
+    game->tick = 0;
+    game->journal = NULL;
+    game->udp = NULL;
+    game->snapshot = NULL;
+    game->red_buckets = NULL;
+    game->blue_buckets = NULL;
+    game->board_hash = NULL;
+    game->bots = NULL;
+    game->bot_num = 0;
+    memset(&game->pending, 0, sizeof(game->pending));
+    memset(&game->batch, 0, sizeof(game->batch));
+    pthread_mutex_init(&game->queue_lock, NULL);
 
     // 여러 thr가 동시에 game 구조체를 액세스하고 수정할 수 있도록
     // multi thr가 동시에 게임 상태 업데이트 or 플레이어의 준비 상태 변경할 때  -> 데이터 경쟁 방지
@@ -92,9 +435,97 @@ void initialize_game(GameInfo *game, int width, int height, int tile_num, int pl
     pthread_cond_init(&game->start_cond, NULL);
 }
 
+// 플레이어 접속 상태 초기화
+static void init_player(Player *player, int p_num)
+{
+    player->player_id = p_num;
+    // 플레이어의 clnt_sd 초기화 = 아직 클라이언트와 연결되지 않았음을 나타냄
+    player->clnt_sd = -1;
+    // 플레이어의 준비 상태를 0으로 초기화 = 준비되지 않은 상태를 나타냄 (y 누르기전)
+    player->ready = 0;
+    player->ack = 0;
+}
+
+// 바뀐 셀 링과 브로드캐스트 목록 (배치가 끝나 타일 수가 정해진 뒤)
+// 한 셀은 표시가 지워지기 전에는 링에 다시 들어가지 않으므로 타일 수만큼이면 넘치지 않음
+static void init_dirty(GameInfo *game)
+{
+    size_t tiles = (size_t)game->red_count + game->blue_count;
+    game->changed_cap = 64;
+    while (game->changed_cap < tiles)
+        game->changed_cap *= 2;
+    game->changed_cells = calloc(game->changed_cap, sizeof(size_t));
+    game->dirty_cells = malloc(game->changed_cap * sizeof(size_t));
+    if (game->changed_cells == NULL || game->dirty_cells == NULL)
+        error_handling("malloc() error");
+}
+
+// 관심 영역: 보드보다 크지 않게, 플레이어를 가운데로
+static void init_views(GameInfo *game)
+{
+    game->views = malloc(game->player_num * sizeof(View));
+    for (int i = 0; i < game->player_num; i++)
+    {
+        View *view = &game->views[i];
+        view->w = game->width < VIEW_WIDTH ? game->width : VIEW_WIDTH;
+        view->h = game->height < VIEW_HEIGHT ? game->height : VIEW_HEIGHT;
+        view->x = clamp(game->players[i].x - view->w / 2, 0, game->width - view->w);
+        view->y = clamp(game->players[i].y - view->h / 2, 0, game->height - view->h);
+    }
+}
+
+// 게임 설정 초기화
+// 같은 시드면 같은 배치 -> 저널로 게임을 그대로 다시 실행할 수 있음
+void initialize_game(GameInfo *game, int width, int height, int tile_num, int play_time, int player_num, int use_bitplanes, unsigned int seed)
+{
+    init_game_state(game, width, height, tile_num, play_time, player_num, seed);
+    board_init(game, use_bitplanes); // 보드 메모리 할당 & 초기화
+
+    // 플레이어 (자리는 아래에서 타일과 함께 정함)
+    game->players = malloc(player_num * sizeof(Player));
+    for (int i = 0; i < player_num; i++)
+    {
+        // index 짝수: RED & 홀수: BLUE
+        game->players[i].team = (i % 2 == 0) ? 'R' : 'B';
+        init_player(&game->players[i], i);
+    }
+
+    // 타일과 플레이어를 서로 다른 칸 tile_num + player_num개에 배치
+    // 칸 수에 비해 적으면 뽑을 개수에만 비례하게, 많으면 보드를 한 번 훑어서 (어느 쪽이든 재시도 없음)
+    size_t k = (size_t)tile_num + player_num;
+    uint64_t rng = seed;
+    if (k * 8 < (size_t)width * height)
+        place_sparse(game, k, &rng);
+    else
+        place_dense(game, k, &rng);
+
+    init_dirty(game);
+    init_views(game);
+}
+
+// 이미 채워진 보드와 플레이어(스냅샷/맵 파일 매핑)로 게임 설정 초기화 (무작위 배치 없음)
+// 팀과 위치만 가져오고 접속 상태와 ack는 새 연결 기준으로 다시 시작
+void initialize_game_mapped(GameInfo *game, int width, int height, int play_time, int player_num, int use_bitplanes, unsigned int seed, char *board, Player *players)
+{
+    init_game_state(game, width, height, 0, play_time, player_num, seed);
+    board_adopt(game, board, use_bitplanes);
+    game->tile_num = game->red_count + game->blue_count;
+
+    game->players = players;
+    for (int i = 0; i < player_num; i++)
+        init_player(&game->players[i], i);
+
+    init_dirty(game);
+    init_views(game);
+}
+
 // 플레이어 위치 명령 처리
+// game->lock 없이 호출: 타일은 CAS로 뒤집고, 위치는 그 플레이어의 명령을 처리하는 스레드만 바꿈
 void process_player_command(char command, int player_id, GameInfo *game)
 {
+    stats_count(ST_COMMANDS, 1);
+    if (game->journal)
+        journal_record(game->journal, game->tick, player_id, command);
     Player *player = &game->players[player_id];
     int newX = player->x;
     int newY = player->y;
@@ -115,37 +546,189 @@ void process_player_command(char command, int player_id, GameInfo *game)
         newX++;
         break;
     case ' ': // 엔터로 타일 뒤집기
-        if (game->board[player->y][player->x] == 'R')
-        {
-            game->board[player->y][player->x] = 'B';
-        }
-        else if (game->board[player->y][player->x] == 'B')
-        {
-            game->board[player->y][player->x] = 'R';
-        }
-        return;
+        if (board_flip(game, player->x, player->y))
+            mark_cell_dirty(game, player->x, player->y);
+        break;
     }
 
+    // 한 번에 한 좌표만 바뀌므로 브로드캐스트가 어느 순간에 읽어도 이전 또는 새 위치
     if (newX >= 0 && newX < game->width && newY >= 0 && newY < game->height)
     {
-        player->x = newX;
-        player->y = newY;
+        __atomic_store_n(&player->x, newX, __ATOMIC_RELAXED);
+        __atomic_store_n(&player->y, newY, __ATOMIC_RELAXED);
     }
-
-    // 모든 클라이언트에 게임 정보를 전송
-    send_game_info_to_all_clients(game);
+    // 결과를 반영한 뒤 처리 수를 올림 -> 새 ack를 읽은 브로드캐스트는 이 명령의 결과도 봄
+    // 막힌 이동이나 빈 칸 뒤집기도 ack는 보내야 하므로 항상 레코드를 다시 보냄
+    __atomic_store_n(&player->ack, player->ack + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&game->player_moved[player_id], 1, __ATOMIC_SEQ_CST);
 }
 
 // 모든 클라이언트에 게임 정보를 전송하는 함수
+// 평소에는 변경분(델타)만, KEYFRAME_INTERVAL마다 또는 관심 영역이 옮겨지면 전체 상태(키프레임)를 보냄
+// 보드가 관심 영역보다 작으면 모두 같은 영역(보드 전체) -> 한 번만 직렬화해 모든 연결이 같은 프레임을 가리킴
+// 관전자는 모두 보드 전체를 보므로 관전자 수와 무관하게 한 번만 직렬화
 void send_game_info_to_all_clients(GameInfo *game)
 {
+    Buffer buf = {0};
+    FanoutFrame frame = {0};
+    FanoutFrame keyframe = {0}; // 밀린 클라이언트용 키프레임 (필요할 때만 직렬화)
+    int shared = game->width <= VIEW_WIDTH && game->height <= VIEW_HEIGHT;
+    int keyframe_due = 0;
+    long t0 = stats_now_ns();
+    long bytes0 = stats_counter(ST_BYTES_SENT), calls0 = stats_counter(ST_SYSCALLS);
+
+    collect_dirty(game);
+    game->seq++;
+    if (++game->since_keyframe >= KEYFRAME_INTERVAL)
+    {
+        game->since_keyframe = 0;
+        keyframe_due = 1;
+    }
+
     // 모든 플레이어 돌기
     for (int i = 0; i < game->player_num; i++)
     {
-        if (game->players[i].ready && game->players[i].clnt_sd != -1) // -1이면 준비아직
+        View *view = &game->views[i];
+        int kind = view_follow(game, i) || keyframe_due ? OUT_KEYFRAME : OUT_DELTA;
+
+        if (!game->players[i].ready || game->players[i].clnt_sd == -1) // -1이면 준비아직
+            continue;
+
+        if (!shared || frame.plain == NULL)
         {
-            send_game_info(game->players[i].clnt_sd, game);
+            if (kind == OUT_KEYFRAME)
+                encode_game_info(&buf, game, view);
+            else
+                encode_game_delta(&buf, game, view);
+            fanout_set(&frame, &buf);
         }
+
+        // UDP 채널을 쓰는 플레이어: 송신 큐를 거치지 않음 (잃은 상태는 다음 데이터그램이나 재동기화가 메움)
+        if (udp_send(game, game->conns[i], frame.plain))
+            continue;
+        if (fanout_send(&frame, game->conns[i], kind) == 1)
+        {
+            // 송신 큐가 밀린 클라이언트 -> 쌓인 델타 대신 최신 키프레임
+            if (!shared || keyframe.plain == NULL)
+            {
+                encode_game_info(&buf, game, view);
+                fanout_set(&keyframe, &buf);
+            }
+            fanout_send(&keyframe, game->conns[i], OUT_KEYFRAME);
+        }
+    }
+
+    // 관전자 (보드 전체)
+    if (game->spectator_num > 0)
+    {
+        View all = {0, 0, game->width, game->height};
+        int kind = keyframe_due ? OUT_KEYFRAME : OUT_DELTA;
+        // 보드가 영역 하나에 들어가면 플레이어 프레임이 곧 보드 전체 -> 그대로 나눠 씀
+        if (!shared || frame.plain == NULL)
+        {
+            fanout_release(&keyframe);
+            if (kind == OUT_KEYFRAME)
+                encode_game_info(&buf, game, &all);
+            else
+                encode_game_delta(&buf, game, &all);
+            fanout_set(&frame, &buf);
+        }
+
+        for (int i = 0; i < game->spectator_num; i++)
+        {
+            Connection *conn = game->spectators[i];
+            if (conn->state != CONN_PLAYING)
+                continue;
+            if (fanout_send(&frame, conn, kind) == 1)
+            {
+                if (keyframe.plain == NULL)
+                {
+                    encode_game_info(&buf, game, &all);
+                    fanout_set(&keyframe, &buf);
+                }
+                fanout_send(&keyframe, conn, OUT_KEYFRAME);
+            }
+        }
+    }
+    clear_dirty(game);
+    fanout_release(&frame);
+    fanout_release(&keyframe);
+
+    // 이 스레드에서 바로 보낸 만큼 (소켓이 밀려 나중에 보내는 양은 총계에만 들어감)
+    stats_count(ST_BROADCASTS, 1);
+    stats_record(ST_FANOUT, stats_now_ns() - t0);
+    stats_record(ST_BCAST_BYTES, stats_counter(ST_BYTES_SENT) - bytes0);
+    stats_record(ST_BCAST_SYSCALLS, stats_counter(ST_SYSCALLS) - calls0);
+}
+
+// UDP 상태를 너무 많이 잃은 클라이언트에게 현재 키프레임을 TCP로 (game->lock 없이 호출)
+static void resync_player(GameInfo *game, int p_num)
+{
+    game_lock(game);
+    send_game_info(game, p_num);
+    game_unlock(game);
+    stats_count(ST_RESYNCS, 1);
+}
+
+// 한 번에 읽은 바이트 중 명령을 모두 적용하고 브로드캐스트는 한 번만 (game->lock 없이 호출)
+// 틱 모드면 큐에 한꺼번에 넣고 다음 틱에 적용, commands는 걸러낸 명령으로 덮어씀
+// 적용하는 동안 inflight에 들어 있음 -> 끝난 뒤 남은 명령은 버리고, 시계는 진행 중인 적용을 기다렸다가 결과를 셈
+void submit_commands(GameInfo *game, int p_num, char *commands, int len)
+{
+    int count = 0;
+    int resync = 0;
+    for (int i = 0; i < len; i++)
+    {
+        char c = commands[i];
+        if (c == CMD_RESYNC)
+            resync = 1;
+        if (c != 'u' && c != 'd' && c != 'l' && c != 'r' && c != ' ')
+            continue;
+        log_command(p_num, c);
+        commands[count++] = c;
+    }
+    if (resync)
+        resync_player(game, p_num);
+    stats_record(ST_READ_BATCH, count);
+    if (count == 0)
+        return;
+
+    // 시계의 ended 저장과 짝을 이루는 순서 (둘 중 하나는 반드시 상대를 봄)
+    __atomic_add_fetch(&game->inflight, 1, __ATOMIC_SEQ_CST);
+    if (game->tick_rate > 0)
+    {
+        if (!__atomic_load_n(&game->ended, __ATOMIC_SEQ_CST))
+            enqueue_commands(game, p_num, commands, count);
+    }
+    else
+    {
+        for (int i = 0; i < count && !__atomic_load_n(&game->ended, __ATOMIC_SEQ_CST); i++)
+        {
+            process_player_command(commands[i], p_num, game);
+        }
+        broadcast_changes(game);
+    }
+    __atomic_sub_fetch(&game->inflight, 1, __ATOMIC_SEQ_CST);
+}
+
+// 명령을 적용한 스레드에서 변경분 브로드캐스트 요청 (game->lock 없이 호출)
+// 다른 스레드가 브로드캐스트 중이면 기다리지 않고 표시만 남김 -> 그 스레드가 lock을 놓은 뒤 한 번 더 보냄
+void broadcast_changes(GameInfo *game)
+{
+    __atomic_store_n(&game->bcast_pending, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&game->bcast_pending, __ATOMIC_SEQ_CST))
+    {
+        if (!game_trylock(game))
+        {
+            if (__atomic_load_n(&game->broadcasting, __ATOMIC_SEQ_CST))
+                return;
+            game_lock(game); // 브로드캐스트가 아닌 일로 잡혀 있음 -> 기다렸다가 직접 보냄
+        }
+        __atomic_store_n(&game->broadcasting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_exchange_n(&game->bcast_pending, 0, __ATOMIC_SEQ_CST))
+            send_game_info_to_all_clients(game);
+        __atomic_store_n(&game->broadcasting, 0, __ATOMIC_SEQ_CST);
+        game_unlock(game);
     }
 }
 
@@ -153,37 +736,47 @@ void *client_handler(void *arg)
 {
     ThreadArg *targ = (ThreadArg *)arg;
     int clnt_sd = targ->clnt_sd;
+    Connection *conn = targ->conn;
     GameInfo *game = targ->game;
     char buffer[256];
     ssize_t numBytes;
 
+    game_lock(game);
     game->players[targ->p_num].clnt_sd = clnt_sd; // clnt_sd 저장
+    game->conns[targ->p_num] = conn;
+    game_unlock(game);
 
     // 플레이어 ID -> clnt 전송
-    if (write(clnt_sd, &targ->p_num, sizeof(targ->p_num)) <= 0)
-    {
-        printf("Failed to send player ID to client %d.\n", targ->p_num);
-        close(clnt_sd);
-        return NULL;
-    }
+    Buffer id_buf = {0};
+    encode_player_id(&id_buf, targ->p_num);
+    conn_send(conn, id_buf.data, id_buf.len, OUT_CONTROL);
+    buf_free(&id_buf);
 
     // 접속 확인을 위해 'y' 입력 받기
     while (1)
     {
-        numBytes = read(clnt_sd, buffer, sizeof(buffer)); // from clnt -> 데이터 읽기
+        numBytes = conn_recv(conn, buffer, sizeof(buffer)); // from clnt -> 데이터 읽기 (그동안 송신 큐 전송)
         if (numBytes <= 0)
         {
             printf("Client %d disconnected.\n", targ->p_num);
-            pthread_mutex_lock(&game->lock);
+            game_lock(game);
             game->players[targ->p_num].ready = 0; // clnt 준비되지 않음으로 설정
             game->players[targ->p_num].clnt_sd = -1;
-            pthread_mutex_unlock(&game->lock);
-            close(clnt_sd);
+            game_unlock(game);
+            conn_shutdown(conn);
             return NULL;
         }
-        if (buffer[0] == 'y')
+        if (memchr(buffer, HANDSHAKE_COMPRESS, numBytes))
+            conn->compress = 1; // 키프레임 압축 요청
+        if (memchr(buffer, HANDSHAKE_UDP, numBytes))
+        { // UDP 채널 요청 (서버가 열어 두지 않았으면 무시)
+            game_lock(game);
+            udp_offer(game, conn);
+            game_unlock(game);
+        }
+        if (memchr(buffer, 'y', numBytes))
         { // 준비 완료 명령 처리
-            pthread_mutex_lock(&game->lock);
+            game_lock(game);
             game->players[targ->p_num].ready = 1;
             printf("Client %d is ready.\n", targ->p_num);
             game->players_ready++;
@@ -191,136 +784,261 @@ void *client_handler(void *arg)
             {
                 pthread_cond_broadcast(&game->start_cond); // 모든 clnt에게 게임 시작 알림
             }
-            pthread_mutex_unlock(&game->lock);
+            game_unlock(game);
             break;
         }
     }
 
     // game 구조체의 데이터에 대한 동시 접근 방지
+    // (cond_wait가 lock을 풀었다 다시 잡으므로 이 구간은 lock 통계에서 뺌)
     pthread_mutex_lock(&game->lock);
     // 모든 플레이어가 준비될 때까지 대기
     while (game->players_ready < game->player_num)
     {
         pthread_cond_wait(&game->start_cond, &game->lock); // 모든 플레이어가 준비될 때까지 대기
     }
+    // 초기 게임 상태(키프레임) 전송 -> 이후 델타와 순서가 섞이지 않도록 lock 안에서
+    conn->state = CONN_PLAYING;
+    send_game_info(game, targ->p_num);
     pthread_mutex_unlock(&game->lock); // 준비 다 됐으니까 Unlock
 
-    // 초기 게임 상태 전송
-    send_game_info(clnt_sd, game);
-
     // 게임 시간이 남아있는 동안 명령을 처리
-    while (game->play_time > 0)
+    while (1)
     {
-        numBytes = read(clnt_sd, buffer, sizeof(buffer)); // 클라이언트로부터 명령 읽기
+        numBytes = conn_recv(conn, buffer, sizeof(buffer)); // 클라이언트로부터 명령 읽기
         if (numBytes <= 0)
         {
             printf("Client %d disconnected during game.\n", targ->p_num);
-            pthread_mutex_lock(&game->lock);
+            game_lock(game);
             game->players[targ->p_num].ready = 0;
             game->players[targ->p_num].clnt_sd = -1;
-            pthread_mutex_unlock(&game->lock);
-            close(clnt_sd);
+            game_unlock(game);
+            conn_shutdown(conn);
             return NULL;
         }
 
-        printf("Client %d command: %c\n", targ->p_num, buffer[0]);
+        // 게임 종료 후: 결과는 main이 보냄 -> 종료 확인 메시지만 기다림
+        if (game_ended(game))
+        {
+            if (memchr(buffer, 'q', numBytes))
+            {
+                printf("Client %d game end.\n", targ->p_num);
+                break;
+            }
+            continue;
+        }
 
-        // 클라이언트 명령을 처리하고 모든 클라이언트에 게임 정보 전송
-        pthread_mutex_lock(&game->lock);
-        process_player_command(buffer[0], targ->p_num, game);
-        pthread_mutex_unlock(&game->lock);
-        send_game_info_to_all_clients(game);
+        // 읽은 명령을 모두 처리하고 모든 클라이언트에 게임 정보 전송 (TCP 조각에 여러 키가 함께 올 수 있음)
+        submit_commands(game, targ->p_num, buffer, numBytes);
     }
 
-    // 게임 종료 후 타일 갯수 전송
-    int red_count, blue_count;
-    calculate_tile_counts(game, &red_count, &blue_count);
+    // 게임 종료 후 소켓 닫기
+    game_lock(game);
+    game->players[targ->p_num].clnt_sd = -1;
+    game_unlock(game);
+    conn_shutdown(conn);
+    return NULL;
+}
+
+// 게임 종료: 타일 수를 세고 접속 중인 모든 플레이어에 결과 전송
+void end_game(GameInfo *game, int *red_count, int *blue_count)
+{
+    calculate_tile_counts(game, red_count, blue_count);
     char winner;
-    if (red_count > blue_count)
+    if (*red_count > *blue_count)
         winner = 'R';
-    else if (blue_count > red_count)
+    else if (*blue_count > *red_count)
         winner = 'B';
     else
         winner = 'T'; // Tie
 
-    // 타일 갯수와 승자를 클라이언트에 전송
-    send_tile_counts(clnt_sd, red_count, blue_count, winner);
-
-    // 클라이언트로부터 종료 확인 메시지를 기다림
-    numBytes = read(clnt_sd, buffer, sizeof(buffer)); // 클라이언트로부터 종료 메시지 읽기
-    if (numBytes > 0 && buffer[0] == 'q')
+    Buffer buf = {0};
+    encode_tile_counts(&buf, game, *red_count, *blue_count, winner);
+    SharedBuf *result = shared_wrap(&buf);
+    game_lock(game);
+    for (int i = 0; i < game->player_num; i++)
     {
-        printf("Client %d game end.\n", targ->p_num);
+        if (game->players[i].ready && game->players[i].clnt_sd != -1)
+        {
+            conn_send_shared(game->conns[i], result, OUT_CONTROL);
+        }
     }
-
-    // 게임 종료 후 소켓 닫기
-    close(clnt_sd);
-    return NULL;
-}
-
-// 게임 상태 업데이트
-void update_game_state(GameInfo *game)
-{
-    pthread_mutex_lock(&game->lock);
-    game->play_time--;                   // 게임 시간 감소
-    send_game_info_to_all_clients(game); // 모든 클라이언트에 게임 상태 전송
-    pthread_mutex_unlock(&game->lock);
+    for (int i = 0; i < game->spectator_num; i++)
+    {
+        if (game->spectators[i]->state == CONN_PLAYING)
+            conn_send_shared(game->spectators[i], result, OUT_CONTROL);
+    }
+    game_unlock(game);
+    shared_release(result);
 }
 
-// 타일 카운트 결과 전송
-void send_tile_counts(int clnt_sd, int red_count, int blue_count, char winner)
+// 게임이 쓰던 메모리 해제 (연결은 모두 닫힌 뒤 호출)
+void destroy_game(GameInfo *game)
 {
-    if (write(clnt_sd, &red_count, sizeof(red_count)) != sizeof(red_count))
+    journal_close(game->journal);
+    udp_close(game->udp);
+    clock_stop(game);
+    bots_free(game);
+    snapshot_close(game); // 매핑한 보드와 플레이어는 여기서 해제
+    board_free(game);
+    free(game->players);
+    free(game->dirty_cells);
+    free(game->changed_cells);
+    free(game->cell_dirty);
+    free(game->player_dirty);
+    free(game->player_moved);
+    free(game->views);
+    free(game->pending.items);
+    free(game->batch.items);
+    for (int i = 0; i < game->player_num; i++)
     {
-        error_handling("Error sending red_count");
+        if (game->conns[i])
+            conn_destroy(game->conns[i]);
     }
-    if (write(clnt_sd, &blue_count, sizeof(blue_count)) != sizeof(blue_count))
+    free(game->conns);
+    for (int i = 0; i < game->spectator_num; i++)
     {
-        error_handling("Error sending blue_count");
+        conn_shutdown(game->spectators[i]);
+        conn_destroy(game->spectators[i]);
     }
-    if (write(clnt_sd, &winner, sizeof(winner)) != sizeof(winner))
+    free(game->spectators);
+    pthread_mutex_destroy(&game->lock);
+    pthread_mutex_destroy(&game->queue_lock);
+    pthread_cond_destroy(&game->start_cond);
+    free(game);
+}
+
+// 게임 하나가 차지하는 메모리 (보드, 플레이어, 연결과 송신 큐 포함)
+size_t game_memory_footprint(GameInfo *game)
+{
+    size_t cells = (size_t)game->width * game->height;
+    size_t bytes = sizeof(GameInfo);
+
+    bytes += cells;                                    // board
+    bytes += cells;                                    // cell_dirty
+    if (game->red_bits)
+        bytes += 2 * game->plane_words * sizeof(uint64_t);
+    bytes += 2 * game->changed_cap * sizeof(size_t); // changed_cells, dirty_cells
+    bytes += game->player_num * (sizeof(Player) + 2 + sizeof(View) + sizeof(Connection *));
+    bytes += (game->pending.cap + game->batch.cap) * sizeof(Command);
+    for (int i = 0; i < game->player_num; i++)
     {
-        error_handling("Error sending winner");
+        Connection *conn = game->conns[i];
+        if (conn)
+            bytes += sizeof(Connection) + OUTQ_FRAMES * sizeof(OutFrame) + conn->queued_bytes;
     }
+    return bytes;
 }
 
-// 타일 카운트 계산
-void calculate_tile_counts(GameInfo *game, int *red_count, int *blue_count)
+// 게임 상태 업데이트 (틱 모드가 아닐 때 게임 시계가 호출)
+void update_game_state(GameInfo *game, int remaining_ms)
 {
-    *red_count = 0;
-    *blue_count = 0;
-    for (int i = 0; i < game->height; i++)
+    game_lock(game);
+    game->tick++;
+    game->play_time = remaining_ms;
+    game_unlock(game);
+    broadcast_changes(game); // 모든 클라이언트에 게임 상태 전송 (남은 시간이 바뀌었으므로 변경이 없어도)
+}
+
+// 게임 시계가 끝났는지 (I/O 스레드가 lock 없이 확인, 끝나면 명령은 더 적용하지 않고 종료 확인만 받음)
+int game_ended(GameInfo *game)
+{
+    return __atomic_load_n(&game->ended, __ATOMIC_ACQUIRE);
+}
+
+typedef struct
+{
+    int serv_sd;
+    GameInfo *game;
+} SpectatorArg;
+
+// 플레이어 접속 하나를 받음 (deadline_ns가 0보다 크면 그 시각까지만 기다림)
+// 반환값: 새 소켓, 마감이 지나면 -1
+static int accept_player(int serv_sd, struct sockaddr *addr, socklen_t *addr_size, long deadline_ns)
+{
+    while (deadline_ns > 0)
     {
-        for (int j = 0; j < game->width; j++)
-        {
-            if (game->board[i][j] == 'R')
-            {
-                (*red_count)++;
-            }
-            else if (game->board[i][j] == 'B')
-            {
-                (*blue_count)++;
-            }
-        }
+        long left_ms = (deadline_ns - stats_now_ns() + 999999) / 1000000;
+        if (left_ms <= 0)
+            return -1;
+        struct pollfd pfd = {.fd = serv_sd, .events = POLLIN};
+        int n = poll(&pfd, 1, left_ms < INT_MAX ? (int)left_ms : INT_MAX);
+        if (n > 0)
+            break;
+        if (n < 0 && errno != EINTR)
+            error_handling("poll() error");
     }
+    int clnt_sd = accept(serv_sd, addr, addr_size);
+    if (clnt_sd < 0)
+        error_handling("accept() error");
+    return clnt_sd;
 }
 
-int main(int argc, char *argv[])
+// 관전자 accept 루프 (리슨 소켓을 shutdown하면 종료)
+static void *spectator_accept_loop(void *arg)
 {
-    if (argc != 11)
+    SpectatorArg *sarg = arg;
+    while (1)
     {
-        fprintf(stderr, "Usage: %s -n <player_num> -s <size> -b <tile_num> -t <time> -p <port>\n", argv[0]);
-        return 1;
+        int clnt_sd = accept(sarg->serv_sd, NULL, NULL);
+        if (clnt_sd < 0)
+            break;
+        reactor_add_spectator(sarg->game, clnt_sd);
     }
+    return NULL;
+}
+
+// 관전자 전용 포트 열기 (관전자는 -n 인원과 준비 대기에 들어가지 않음)
+static void spectator_listen(SpectatorArg *sarg, pthread_t *thread, int port)
+{
+    struct sockaddr_in adr;
+    memset(&adr, 0, sizeof(adr));
+    adr.sin_family = AF_INET;
+    adr.sin_addr.s_addr = htonl(INADDR_ANY);
+    adr.sin_port = htons(port);
+
+    sarg->serv_sd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sarg->serv_sd < 0)
+        error_handling("Socket creation failed");
+    if (bind(sarg->serv_sd, (struct sockaddr *)&adr, sizeof(adr)) < 0)
+        error_handling("bind() error");
+    if (listen(sarg->serv_sd, SOMAXCONN) < 0)
+        error_handling("listen() error");
+    if (pthread_create(thread, NULL, spectator_accept_loop, sarg) != 0)
+        error_handling("pthread_create() error");
+}
 
-    int serv_sd, clnt_sd, port, player_num, width, height, tile_num, play_time;
+int main(int argc, char *argv[])
+{
+    int serv_sd, clnt_sd;
+    int port = -1, player_num = -1, width = -1, height = -1, tile_num = -1;
+    int play_time = -1;    // 게임 시간 (ms, -t는 초 단위, -T는 ms 단위)
+    int reactor_num = 0; // 0이면 클라이언트마다 스레드 하나 (기존 방식)
+    int use_bitplanes = 0; // 1이면 RED/BLUE 비트플레인 유지
+    int tick_rate = 0;     // 초당 틱 수 (0이면 틱 모드 사용 안 함)
+    int max_rooms = -1;    // 방 모드에서 열 방 수 (-1이면 게임 하나만, 0이면 무제한)
+    int log_rate = 0;      // 초당 명령 로그 줄 수 (0이면 로그 안 함)
+    unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)getpid(); // 배치 시드 (-S로 고정)
+    const char *journal_path = NULL; // 명령 저널 파일 (-j)
+    const char *replay_path = NULL;  // 다시 실행할 저널 (-P)
+    int bench_threads = 0;           // 보드 변경 벤치마크 최대 스레드 수 (-B)
+    int spectator_port = -1;         // 관전자 포트 (-w, -1이면 관전 없음)
+    int udp_port = -1;               // UDP 상태 채널 포트 (-u, -1이면 모든 상태를 TCP로)
+    int udp_loss = 0;                // UDP 손실 시험 비율 (-L, %)
+    const char *snapshot_path = NULL; // 보드와 플레이어를 매핑해 둘 스냅샷 파일 (-m, 있으면 이어서 진행)
+    const char *map_path = NULL;      // 배치를 불러올 맵 파일 (-M, 바꾸지 않음)
+    const char *generate_path = NULL; // 만들 맵 파일 (-G)
+    int bot_num = 0;                  // 최소 서버 봇 수 (-a, player_num 중 마지막 자리들을 채움)
+    int fill_ms = -1;                 // 사람을 기다리는 시간 (-A, ms, 지나면 남은 자리를 봇으로, -1이면 끝까지 기다림)
+    SpectatorArg spectator_arg;
+    pthread_t spectator_thread;
     struct sockaddr_in serv_adr, client_addr;
     socklen_t client_addr_size;
-    pthread_t *threads;
-    GameInfo *game = malloc(sizeof(GameInfo)); // 게임 정보 동적 할당
+    pthread_t *threads = NULL;
+    ThreadArg *thread_args = NULL;
 
     // game setting을 위한
-    for (int i = 1; i < argc; i += 2)
+    for (int i = 1; i + 1 < argc; i += 2)
     {
         if (strcmp(argv[i], "-n") == 0)
             player_num = atoi(argv[i + 1]);
@@ -329,13 +1047,117 @@ int main(int argc, char *argv[])
         else if (strcmp(argv[i], "-b") == 0)
             tile_num = atoi(argv[i + 1]);
         else if (strcmp(argv[i], "-t") == 0)
+            play_time = atoi(argv[i + 1]) * 1000;
+        else if (strcmp(argv[i], "-T") == 0)
             play_time = atoi(argv[i + 1]);
         else if (strcmp(argv[i], "-p") == 0)
             port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-e") == 0)
+            reactor_num = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-c") == 0)
+            use_bitplanes = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0)
+            tick_rate = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-R") == 0)
+            max_rooms = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-l") == 0)
+            log_rate = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-S") == 0)
+            seed = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "-j") == 0)
+            journal_path = argv[i + 1];
+        else if (strcmp(argv[i], "-P") == 0)
+            replay_path = argv[i + 1];
+        else if (strcmp(argv[i], "-w") == 0)
+            spectator_port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-u") == 0)
+            udp_port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-L") == 0)
+            udp_loss = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-B") == 0)
+            bench_threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-m") == 0)
+            snapshot_path = argv[i + 1];
+        else if (strcmp(argv[i], "-M") == 0)
+            map_path = argv[i + 1];
+        else if (strcmp(argv[i], "-G") == 0)
+            generate_path = argv[i + 1];
+        else if (strcmp(argv[i], "-a") == 0)
+            bot_num = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-A") == 0)
+            fill_ms = atoi(argv[i + 1]);
+    }
+    if (bot_num > 0 && fill_ms < 0)
+        fill_ms = BOT_FILL_MS; // 봇을 쓰면 사람이 덜 모여도 게임이 시작되도록
+
+    // 재생 모드: 소켓 없이 저널만 다시 실행
+    if (replay_path && argc == 3)
+        return journal_replay(replay_path);
+    // 벤치마크 모드: 소켓 없이 보드 변경 경합만 측정
+    if (bench_threads > 0 && argc == 3)
+        return board_bench(bench_threads);
+
+    // 스냅샷/맵 파일이 있으면 보드와 플레이어를 파일에서 (-n, -s, -b는 파일 값으로 대체)
+    GameInfo *game = NULL;
+    if ((snapshot_path || map_path) && !(snapshot_path && map_path) && max_rooms < 0)
+    {
+        game = snapshot_restore(snapshot_path ? snapshot_path : map_path, snapshot_path != NULL, play_time, use_bitplanes);
+        if (game)
+        {
+            player_num = game->player_num;
+            width = game->width;
+            height = game->height;
+            tile_num = game->tile_num;
+            play_time = game->play_time;
+            seed = game->seed;
+        }
     }
 
-    printf("Game setup:\nPlayers: %d\nBoard Size: %dx%d\nTiles: %d\nTime: %d seconds\nPort: %d\n\n",
-           player_num, width, height, tile_num, play_time, port);
+    // 타일과 플레이어가 모두 서로 다른 칸에 놓여야 함
+    if (width > 0 && (long)tile_num + player_num > (long)width * height)
+    {
+        fprintf(stderr, "Too many tiles and players: %d + %d > %ld cells\n", tile_num, player_num, (long)width * height);
+        return 1;
+    }
+    // 맵 생성 모드: 무작위 배치를 파일로 남기고 끝냄
+    if (generate_path && player_num > 0 && player_num <= WIRE_MAX_DIM && width > 0 && width <= WIRE_MAX_DIM && tile_num >= 0)
+        return snapshot_generate(generate_path, width, height, tile_num, player_num, seed);
+    if (argc % 2 == 0 || player_num <= 0 || player_num > WIRE_MAX_DIM || width <= 0 || width > WIRE_MAX_DIM || tile_num < 0 || play_time <= 0 || port < 0 || reactor_num < 0 || tick_rate < 0 || max_rooms < -1 || log_rate < 0 ||
+        (spectator_port >= 0 && max_rooms >= 0) || (udp_port >= 0 && max_rooms >= 0) || udp_loss < 0 || udp_loss > 100 ||
+        (udp_loss > 0 && udp_port < 0) || ((snapshot_path || map_path) && (max_rooms >= 0 || journal_path)) ||
+        (snapshot_path && map_path) || generate_path || bot_num < 0 || bot_num > player_num ||
+        fill_ms < -1 || ((bot_num > 0 || fill_ms >= 0) && max_rooms >= 0))
+    {
+        fprintf(stderr, "Usage: %s -n <player_num> -s <size> -b <tile_num> -t <seconds> | -T <ms> -p <port> [-e <reactors>] [-c <bitplanes 0|1>] [-r <tick_rate>] [-R <rooms>] [-l <log lines/s>] [-S <seed>] [-j <journal>] [-w <spectator port>] [-u <udp port> [-L <udp loss %%>]] [-m <snapshot> | -M <map>] [-a <min bots>] [-A <fill ms>]\n"
+                        "       %s -P <journal>\n"
+                        "       %s -B <max threads>\n"
+                        "       %s -G <map> -n <player_num> -s <size> -b <tile_num> [-S <seed>]\n", argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    // 방 모드는 epoll 리액터 위에서만 동작 (기본: CPU 코어 수만큼)
+    if (max_rooms >= 0 && reactor_num == 0)
+        reactor_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    // 끊어진 소켓에 write해도 서버가 죽지 않도록
+    signal(SIGPIPE, SIG_IGN);
+    // 통계 수집 시작 (SIGUSR1로 언제든 출력)
+    stats_start(log_rate);
+
+    printf("Game setup:\nPlayers: %d\nBoard Size: %dx%d\nTiles: %d\nTime: %d ms\nPort: %d\nSeed: %u\n",
+           player_num, width, height, tile_num, play_time, port, seed);
+    if (reactor_num > 0)
+        printf("Mode: epoll (%d reactors)\n\n", reactor_num);
+    else
+        printf("Mode: thread per client\n\n");
+    if (tick_rate > 0)
+        printf("Tick rate: %d/s\n\n", tick_rate);
+    if (max_rooms > 0)
+        printf("Rooms: %d\n\n", max_rooms);
+    else if (max_rooms == 0)
+        printf("Rooms: unlimited\n\n");
+    if (fill_ms >= 0)
+        printf("Bots: at least %d, empty seats after %d ms\n\n", bot_num, fill_ms);
 
     // 소켓 생성
     serv_sd = socket(AF_INET, SOCK_STREAM, 0);
@@ -352,77 +1174,159 @@ int main(int argc, char *argv[])
         error_handling("bind() error");
 
     // 클라이언트 연결 대기 상태로 설정
-    if (listen(serv_sd, player_num) < 0)
+    if (listen(serv_sd, max_rooms >= 0 ? SOMAXCONN : player_num) < 0)
         error_handling("listen() error");
 
-    // 게임 초기화
-    initialize_game(game, width, height, tile_num, play_time, player_num);
-
-    // 각 플레이어마다 하나의 스레드가 필요 -> player_num만큼의 pthread_t 크기를 곱하여 할당
-    threads = malloc(player_num * sizeof(pthread_t));
-    // 각 스레드가 고유의 인수(ThreadArg)를 가짐 -> player_num만큼의 ThreadArg 크기를 곱하여 할당
-    ThreadArg *thread_args = malloc(player_num * sizeof(ThreadArg));
-    // clnt 주소 구조체의 크기를 client_addr_size 변수에 저장
-    // 이후 accept에서 clnt의 연결 요청을 수락할 때 사용
-    client_addr_size = sizeof(client_addr);
+    if (max_rooms >= 0)
+    {
+        // 방 모드: 인원이 찰 때마다 새 게임을 열어 여러 게임을 동시에 진행
+        LobbyConfig cfg = {width, height, tile_num, play_time, player_num, use_bitplanes, tick_rate, max_rooms, seed, journal_path};
+        reactor_start(reactor_num);
+        run_lobby(serv_sd, &cfg);
+        reactor_stop();
+        stats_dump();
+        close(serv_sd);
+        return 0;
+    }
 
-    // 각 clnt에 대해 스레드 생성
-    for (int i = 0; i < player_num; i++)
+    if (game == NULL)
     {
-        clnt_sd = accept(serv_sd, (struct sockaddr *)&client_addr, &client_addr_size);
-        if (clnt_sd < 0)
-            error_handling("accept() error");
+        game = malloc(sizeof(GameInfo)); // 게임 정보 동적 할당
 
-        printf("Player %d has connected.\n", i);
-        thread_args[i].p_num = i;
-        thread_args[i].clnt_sd = clnt_sd;
-        thread_args[i].game = game;
-        pthread_create(&threads[i], NULL, client_handler, &thread_args[i]);
+        // 게임 초기화
+        long init_ns = stats_now_ns();
+        initialize_game(game, width, height, tile_num, play_time, player_num, use_bitplanes, seed);
+        printf("Board initialized in %.3f ms\n", (stats_now_ns() - init_ns) / 1e6);
+        if (snapshot_path)
+        {
+            // 새 스냅샷 파일: 지금 배치부터 파일에 두고 바로 한 번 저장
+            game->snapshot = snapshot_create(snapshot_path, game);
+            snapshot_save(game, 0);
+            printf("Snapshot: %s\n", snapshot_path);
+        }
     }
+    game->tick_rate = tick_rate;
+    if (journal_path)
+        game->journal = journal_open(journal_path, game);
 
-    // 게임 시간이 끝날 때까지 상태 업데이트
-    while (game->play_time > 0)
+    // 관전자와 UDP 채널은 리액터 위에서만 처리 (스레드 모드면 이들을 위한 리액터 하나)
+    int reactors = reactor_num > 0 ? reactor_num : (spectator_port >= 0 || udp_port >= 0 ? 1 : 0);
+    if (reactors > 0)
+        reactor_start(reactors);
+    if (udp_port >= 0)
+    {
+        game->udp = udp_open(game, udp_port, udp_loss);
+        printf("UDP state channel: port %d (test loss %d%%)\n\n", udp_port, udp_loss);
+    }
+    if (spectator_port >= 0)
     {
-        update_game_state(game);
-        sleep(1); // 1초 대기
+        spectator_arg.game = game;
+        spectator_listen(&spectator_arg, &spectator_thread, spectator_port);
+        printf("Spectators: port %d\n\n", spectator_port);
     }
+    // clnt 주소 구조체의 크기를 client_addr_size 변수에 저장
+    // 이후 accept에서 clnt의 연결 요청을 수락할 때 사용
+    client_addr_size = sizeof(client_addr);
 
-    // 타일 카운트 계산
-    int red_count, blue_count;
-    calculate_tile_counts(game, &red_count, &blue_count);
-    char winner;
-    if (red_count > blue_count)
-        winner = 'R';
-    else if (blue_count > red_count)
-        winner = 'B';
-    else
-        winner = 'T'; // Tie
+    // 사람은 앞자리부터, 최소 봇 수만큼의 마지막 자리는 남겨 둠 (마감이 지나면 그때까지 온 사람만)
+    long fill_deadline = fill_ms >= 0 ? stats_now_ns() + fill_ms * 1000000L : 0;
+    int humans = 0;
+    if (reactor_num > 0)
+    {
+        // epoll 모드: 고정된 수의 리액터 스레드가 모든 소켓을 처리
+        for (; humans < player_num - bot_num; humans++)
+        {
+            clnt_sd = accept_player(serv_sd, (struct sockaddr *)&client_addr, &client_addr_size, fill_deadline);
+            if (clnt_sd < 0)
+                break;
 
-    // 타일 카운트 결과를 모든 클라이언트에 전송
-    for (int i = 0; i < player_num; i++)
+            printf("Player %d has connected.\n", humans);
+            reactor_add_client(game, clnt_sd, humans);
+        }
+    }
+    else
     {
-        if (game->players[i].ready && game->players[i].clnt_sd != -1)
+        // 각 플레이어마다 하나의 스레드가 필요 -> player_num만큼의 pthread_t 크기를 곱하여 할당
+        threads = malloc(player_num * sizeof(pthread_t));
+        // 각 스레드가 고유의 인수(ThreadArg)를 가짐 -> player_num만큼의 ThreadArg 크기를 곱하여 할당
+        thread_args = malloc(player_num * sizeof(ThreadArg));
+
+        // 각 clnt에 대해 스레드 생성
+        for (; humans < player_num - bot_num; humans++)
         {
-            send_tile_counts(game->players[i].clnt_sd, red_count, blue_count, winner);
+            int i = humans;
+            clnt_sd = accept_player(serv_sd, (struct sockaddr *)&client_addr, &client_addr_size, fill_deadline);
+            if (clnt_sd < 0)
+                break;
+
+            printf("Player %d has connected.\n", i);
+            thread_args[i].p_num = i;
+            thread_args[i].clnt_sd = clnt_sd;
+            thread_args[i].conn = conn_create(game, clnt_sd, i, -1);
+            thread_args[i].game = game;
+            pthread_create(&threads[i], NULL, client_handler, &thread_args[i]);
         }
     }
 
+    // 사람이 차지하지 않은 자리는 모두 봇으로 (사람이 이미 모두 준비했으면 여기서 시작)
+    bot_num = player_num - humans;
+    if (bot_num > 0)
+    {
+        printf("Bots: %d (players %d-%d)\n", bot_num, humans, player_num - 1);
+        bots_start(game, bot_num, reactor_num > 0);
+    }
+
+    // 모든 플레이어가 준비되면 게임 시계 시작 (준비를 기다리는 동안에는 시간이 흐르지 않음)
+    pthread_mutex_lock(&game->lock);
+    while (game->players_ready < game->player_num)
+        pthread_cond_wait(&game->start_cond, &game->lock);
+    pthread_mutex_unlock(&game->lock);
+
+    // 게임 시간이 끝날 때까지 시계가 울릴 때마다 상태 업데이트 (끝나면 game->ended로 I/O 스레드에 알림)
+    clock_start(game, 0);
+    while (!clock_on_timer(game))
+        ;
+
+    // 타일 카운트 계산 및 결과 전송
+    int red_count, blue_count;
+    end_game(game, &red_count, &blue_count);
+    snapshot_save(game, 1); // 끝난 게임으로 저장 (다음에 열면 이 보드로 새 게임)
+
     // 서버에 타일 카운트 결과 출력
     printf("Red tiles: %d\n", red_count);
     printf("Blue tiles: %d\n", blue_count);
+    if (journal_path)
+        printf("Checksum: %016llx\n", (unsigned long long)game_checksum(game));
 
-    // 모든 클라이언트로부터 종료 확인 메시지를 기다림
-    for (int i = 0; i < player_num; i++)
+    // 관전자 접속 종료 (accept를 깨워 스레드가 끝나게 함)
+    if (spectator_port >= 0)
     {
-        pthread_join(threads[i], NULL);
+        shutdown(spectator_arg.serv_sd, SHUT_RDWR);
+        pthread_join(spectator_thread, NULL);
+        close(spectator_arg.serv_sd);
     }
 
+    // 모든 클라이언트로부터 종료 확인 메시지를 기다림 (관전자는 기다리지 않음)
+    if (reactor_num > 0)
+    {
+        reactor_wait_closed();
+    }
+    else
+    {
+        for (int i = 0; i < humans; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    if (reactors > 0)
+        reactor_stop();
+
+    stats_dump();
+
     // 메모리 해제 및 소켓 닫기
     free(threads);
     free(thread_args);
-    free(game->board);
-    free(game->players);
-    free(game);
+    destroy_game(game);
     close(serv_sd);
     return 0;
 }
@@ -7,6 +7,10 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include "protocol.h"
 
 #define RED 'R'
 #define BLUE 'B'
@@ -16,6 +20,22 @@
 #define UP 72
 #define DOWN 80
 
+#define KEYFRAME_INTERVAL 30   // 키프레임을 다시 보내는 브로드캐스트 주기
+#define VIEW_WIDTH 48          // 플레이어별 관심 영역 크기 (보드가 더 작으면 보드 전체)
+#define VIEW_HEIGHT 24
+#define VIEW_MARGIN 4          // 플레이어가 영역 가장자리에 이만큼 다가가면 영역을 옮김
+#define OUTQ_FRAMES 64         // 연결별 송신 큐 최대 프레임 수
+#define OUTQ_MAX_BYTES (4 << 20) // 연결별 송신 큐 최대 바이트 (넘으면 델타 대신 키프레임)
+#define CLOCK_INTERVAL_MS 1000 // 틱 모드가 아닐 때 남은 시간을 알리는 간격
+#define SNAPSHOT_INTERVAL_MS 1000 // 스냅샷 머리를 갱신하고 디스크 쓰기를 요청하는 간격
+#define BOT_INTERVAL_MS 100    // 틱 모드가 아닐 때 봇이 한 걸음씩 움직이는 간격
+#define BOT_FILL_MS 10000      // -a만 주었을 때 사람을 기다리는 시간 (지나면 남은 자리를 봇으로)
+#define LOBBY_POLL_MS 100      // 방이 모두 찬 뒤 시작 전에 빈자리가 생기는지 확인하는 간격
+#define BUCKET_SIZE 32         // 타일 위치 색인 한 칸의 크기 (BUCKET_SIZE x BUCKET_SIZE 셀)
+
+// 보드 셀 접근 (board는 width * height 크기의 한 덩어리)
+#define CELL(game, x, y) ((game)->board[(size_t)(y) * (game)->width + (x)])
+
 typedef struct
 {
     int player_id; // 플레이어 ID
@@ -24,19 +44,96 @@ typedef struct
     int y;         // y 좌표
     int ready;     // 준비 상태 (0 또는 1)
     int clnt_sd;   // 클라이언트 소켓 디스크립터
+    unsigned int ack; // 처리한 명령 수 (플레이어 레코드에 실어 클라이언트가 예측을 맞춤)
 } Player;
 
+typedef struct Connection Connection;
+typedef struct Room Room;
+typedef struct Journal Journal;
+typedef struct UdpChannel UdpChannel;
+typedef struct Snapshot Snapshot;
+typedef struct Bot Bot;
+
+// 틱 모드에서 다음 틱에 적용할 플레이어 명령
+typedef struct
+{
+    int player_id;
+    char command;
+} Command;
+
+typedef struct
+{
+    Command *items;
+    int count;
+    int cap;
+} CommandQueue;
+
+// 게임 시계: timerfd가 시작 시각 기준 interval_ns 격자마다 울림 (끝 시각에는 정확히 한 번 더)
+// 남은 시간은 울린 횟수가 아니라 실제 흐른 시간으로 계산 -> 처리가 밀려도 시계는 밀리지 않음
+typedef struct
+{
+    int timer_fd;     // timerfd (시작 전에는 -1)
+    long interval_ns; // 울리는 간격 (틱 모드면 1/tick_rate초, 아니면 CLOCK_INTERVAL_MS 또는 봇이 있으면 BOT_INTERVAL_MS)
+    long start_ns;    // 시작 시각 (CLOCK_MONOTONIC)
+    long end_ns;      // 끝 시각
+    long next_ns;     // 다음에 울릴 시각
+} GameClock;
+
 typedef struct
 {
     int width;                 // 보드의 너비
     int height;                // 보드의 높이
     int tile_num;              // 타일의 수
-    int play_time;             // 남은 게임 시간
+    int play_time;             // 남은 게임 시간 (ms, 시계 스레드가 game->lock 안에서 갱신)
+    int ended;                 // 시계가 끝남 (원자적으로 한 번 설정, I/O 스레드는 game_ended로 확인)
+    int inflight;              // 명령을 적용하는 중인 I/O 스레드 수 (시계는 끝낼 때 0이 되기를 기다림)
+    GameClock clock;           // 게임 시계
     int player_num;            // 플레이어의 수
     int players_ready;         // 준비 완료된 플레이어 수
-    char **board;              // 보드의 상태
+    char *board;               // 보드의 상태 (행 우선, width * height)
+    uint64_t *red_bits;        // RED 타일 비트플레인 (NULL이면 사용 안 함)
+    uint64_t *blue_bits;       // BLUE 타일 비트플레인
+    size_t plane_words;        // 비트플레인 하나의 64비트 워드 수
+    int *red_buckets;          // 위치 색인: 칸별 RED 타일 수 (NULL이면 사용 안 함, 뒤집을 때마다 원자적으로 갱신)
+    int *blue_buckets;         // 위치 색인: 칸별 BLUE 타일 수
+    int bucket_cols;           // 위치 색인 칸 수 (가로)
+    int bucket_rows;           // 위치 색인 칸 수 (세로)
+    uint64_t *board_hash;      // 보드 해시 (스냅샷 파일이 가리킴, NULL이면 사용 안 함, 뒤집을 때마다 원자적으로 갱신)
+    int red_count;             // 현재 RED 타일 수 (셀 변경마다 원자적으로 갱신)
+    int blue_count;            // 현재 BLUE 타일 수
     Player *players;           // 플레이어 배열
-    pthread_mutex_t lock;      // 뮤텍스
+    unsigned int seq;          // 마지막 브로드캐스트 시퀀스 번호
+    int since_keyframe;        // 마지막 키프레임 이후 브로드캐스트 횟수
+    size_t *dirty_cells;       // 이번 브로드캐스트가 보내는 바뀐 셀 (y * width + x, collect_dirty가 채움)
+    int dirty_count;           // dirty_cells 항목 수
+    char *player_dirty;        // 이번 브로드캐스트가 보내는 플레이어별 이동 표시
+    size_t *changed_cells;     // 명령이 바꾸고 아직 브로드캐스트가 가져가지 않은 셀의 링 (셀 + 1, 0이면 아직 안 씀)
+    unsigned long changed_head; // 브로드캐스트가 다음에 가져갈 링 위치 (collect_dirty만 바꿈)
+    unsigned long changed_tail; // 명령 스레드가 다음에 쓸 링 위치 (원자적으로 증가)
+    size_t changed_cap;        // 링과 dirty_cells 크기 (2의 거듭제곱, 타일 수 이상 -> 넘치지 않음)
+    char *cell_dirty;          // 셀별 변경 표시 (CAS로 처음 표시한 스레드만 링에 씀)
+    char *player_moved;        // 플레이어별 이동 표시 (원자적으로 설정, 브로드캐스트가 가져가며 지움)
+    int bcast_pending;         // 아직 브로드캐스트하지 않은 변경이 있음
+    int broadcasting;          // 어떤 스레드가 lock을 잡고 브로드캐스트 중
+    View *views;               // 플레이어별 관심 영역 (이 영역만 전송)
+    Connection **conns;        // 플레이어별 연결 (접속 전이면 NULL)
+    Connection **spectators;   // 관전자 연결 (닫힌 것도 게임이 끝날 때까지 유지)
+    int spectator_num;
+    int spectator_cap;
+    int tick_rate;             // 초당 틱 수 (0이면 명령마다 바로 브로드캐스트)
+    CommandQueue pending;      // 다음 틱에 적용할 명령 (queue_lock으로 보호)
+    CommandQueue batch;        // 틱 스레드가 적용 중인 명령
+    pthread_mutex_t queue_lock; // pending 보호 (game->lock과 별개)
+    Room *room;                // 방 모드에서 소속 방 (단일 게임이면 NULL)
+    unsigned int seed;         // 타일과 플레이어 배치에 쓴 시드
+    long tick;                 // 게임 시계가 진행한 횟수 (저널 레코드의 tick)
+    Journal *journal;          // 적용한 명령 기록 (NULL이면 기록 안 함)
+    UdpChannel *udp;           // UDP 상태 채널 (NULL이면 모든 상태를 TCP로)
+    Snapshot *snapshot;        // 보드와 플레이어를 담은 파일 매핑 (NULL이면 둘 다 힙에)
+    Bot *bots;                 // 서버 봇 (사람이 차지하지 않은 마지막 bot_num개 자리, 게임 시계 스레드가 움직임)
+    int bot_num;
+    long lock_taken_ns;        // lock을 잡은 시각 (보유 시간 측정용)
+    pthread_mutex_t lock;      // 준비 상태, 연결 목록, 관심 영역, 브로드캐스트 보호 (보드 변경은 lock 없이 원자 연산)
     pthread_cond_t start_cond; // 조건 변수
 } GameInfo;
 
@@ -44,17 +141,282 @@ typedef struct
 {
     int p_num;
     int clnt_sd;
+    Connection *conn;
     GameInfo *game;
 } ThreadArg;
 
+// epoll 이벤트 대상 구분 (data.ptr가 가리키는 구조체의 첫 멤버)
+enum
+{
+    EV_CONN = 1, // Connection
+    EV_TIMER,    // Room 게임 시계
+    EV_UDP       // UdpChannel 소켓
+};
+
+// 연결 상태
+enum
+{
+    CONN_HANDSHAKE, // 'y' 대기 (그 전에 HANDSHAKE_COMPRESS를 받으면 압축 사용)
+    CONN_PLAYING,   // 게임 진행 중
+    CONN_CLOSED     // 연결 종료
+};
+
+// 송신 큐 프레임 종류
+enum
+{
+    OUT_CONTROL,  // 플레이어 ID, 결과 등 (버리지 않음)
+    OUT_DELTA,    // 델타 (밀리면 버리고 키프레임으로 대체)
+    OUT_KEYFRAME  // 키프레임 (이전 상태 프레임을 대체)
+};
+
+// 여러 연결의 송신 큐가 함께 가리키는 직렬화된 프레임 (마지막 참조가 풀릴 때 해제)
+typedef struct
+{
+    int refs; // 원자적으로 증감
+    char *data;
+    size_t len;
+} SharedBuf;
+
+// 한 번 직렬화해 여러 연결에 보내는 프레임 (압축본은 압축을 요청한 연결이 있을 때 한 번만 만듦)
+typedef struct
+{
+    SharedBuf *plain;
+    SharedBuf *packed;
+} FanoutFrame;
+
+// 송신 큐에 쌓인 프레임 하나
+typedef struct
+{
+    SharedBuf *buf;
+    int kind; // OUT_*
+} OutFrame;
+
+// 클라이언트 연결 (논블로킹 소켓 + 제한된 크기의 송신 큐)
+struct Connection
+{
+    int ev_type;              // EV_CONN
+    int fd;                   // 클라이언트 소켓
+    int p_num;                // 플레이어 번호
+    int state;                // CONN_*
+    int epfd;                 // 소속 리액터의 epoll fd (스레드 모드면 -1)
+    int wake_fd;              // 스레드 모드에서 송신 대기를 알리는 eventfd
+    GameInfo *game;           // 소속 게임
+    pthread_mutex_t out_lock; // 송신 큐 보호
+    OutFrame *ring;           // 송신 큐 (OUTQ_FRAMES 크기의 원형 버퍼)
+    int ring_head;            // 맨 앞 프레임 위치
+    int ring_count;           // 큐에 있는 프레임 수
+    size_t head_off;          // 맨 앞 프레임에서 이미 보낸 바이트
+    size_t queued_bytes;      // 큐에 남은 전체 바이트
+    int need_keyframe;        // 밀려서 상태를 버렸음 -> 다음에 키프레임 필요
+    long coalesced;           // 버려진 상태 프레임 수
+    int want_write;           // 쓰기 대기 등록 여부
+    int compress;             // 키프레임을 압축해서 보냄 (핸드셰이크에서 요청)
+    int spectator;            // 관전자 (p_num 없음, 명령은 무시)
+    uint32_t udp_token;       // UDP 주소 등록 확인용 (안내를 보내기 전에는 0, game->lock으로 보호)
+    int udp_ready;            // UDP 주소를 등록해 상태 프레임을 UDP로 받음
+    struct sockaddr_in udp_addr; // 등록된 UDP 주소
+    SharedBuf *udp_prev;      // 직전에 UDP로 보낸 상태 프레임 (다음 데이터그램에 함께 실음)
+};
+
+// 방 모드에서 동시에 진행되는 게임 하나 (한 리액터 스레드가 전담)
+struct Room
+{
+    int ev_type;                // EV_TIMER
+    int id;                     // 방 번호
+    int reactor_idx;            // 방을 맡은 리액터
+    GameInfo *game;             // 방의 게임
+    int joined;                 // 들어와 있는 플레이어 수
+    int full;                   // 인원이 다 찼는지
+    int started;                // 게임 시계가 돌기 시작했는지 (원자적으로 읽고 씀)
+    int *free_slots;            // 시작 전에 나가 비워진 플레이어 자리 (다음 접속이 먼저 씀)
+    int free_num;
+    Connection **left;          // 자리를 비운 연결 (이벤트 배치가 끝난 뒤 room_reap에서 해제)
+    int left_num;
+    int open_conns;             // 아직 열린 연결 수
+    int ended;                  // 결과를 보냈는지
+    int dead;                   // 연결이 모두 닫혀 정리 대기
+    long cpu_ns;                // 이 방 처리에 쓴 CPU 시간
+    size_t peak_memory;         // 진행 중 최대 메모리 사용량
+    int red_count;              // 최종 결과
+    int blue_count;
+    Room *next;
+};
+
+// 통계 히스토그램 (2의 거듭제곱 구간)
+#define HIST_BUCKETS 65
+typedef struct
+{
+    long count;
+    long sum;
+    long max;
+    long buckets[HIST_BUCKETS];
+} Histogram;
+
+// 히스토그램 종류
+enum
+{
+    ST_FANOUT,         // 브로드캐스트 한 번에 걸린 시간 (ns)
+    ST_BCAST_BYTES,    // 브로드캐스트 한 번에 보낸 바이트
+    ST_BCAST_SYSCALLS, // 브로드캐스트 한 번에 쓴 송신 시스템 콜
+    ST_LOCK_WAIT,      // game->lock 대기 시간 (ns)
+    ST_LOCK_HOLD,      // game->lock 보유 시간 (ns)
+    ST_QUEUE_DEPTH,    // 프레임을 넣은 직후 송신 큐 길이
+    ST_KF_COMPRESS,    // 키프레임 압축 시간 (ns)
+    ST_KF_RATIO,       // 키프레임 압축률 (압축 후 / 전, %)
+    ST_READ_BATCH,     // 수신 한 번에 들어온 명령 수
+    ST_SNAPSHOT,       // 스냅샷 한 번에 걸린 시간 (체크섬 + msync, ns)
+    ST_BOT_STEP,       // 모든 봇이 한 걸음씩 움직이는 데 걸린 시간 (ns)
+    ST_HIST_COUNT
+};
+
+// 카운터 종류
+enum
+{
+    ST_COMMANDS,   // 적용한 명령
+    ST_BROADCASTS, // 브로드캐스트 횟수
+    ST_BYTES_SENT, // 소켓으로 보낸 바이트
+    ST_SYSCALLS,   // sendmsg 호출
+    ST_ENCODES,    // 직렬화한 상태 프레임 (받는 연결 수와 무관)
+    ST_KF_RAW,     // 압축한 키프레임의 원래 바이트
+    ST_KF_PACKED,  // 압축한 키프레임의 압축 후 바이트
+    ST_UDP_SENT,   // 보낸 UDP 데이터그램
+    ST_UDP_LOST,   // 손실 시험으로 버린 UDP 데이터그램
+    ST_RESYNCS,    // 클라이언트 요청으로 TCP로 다시 보낸 키프레임
+    ST_CLOCK_LATE, // 처리가 밀려 건너뛴 시계 격자 (다음 울림에 합쳐 처리)
+    ST_COUNTER_COUNT
+};
+
+// 방 모드 설정
+typedef struct
+{
+    int width;
+    int height;
+    int tile_num;
+    int play_time; // ms
+    int player_num;
+    int use_bitplanes;
+    int tick_rate;
+    int max_rooms; // 이만큼 방을 연 뒤 종료 (0이면 무제한)
+    unsigned int seed;        // 방 번호를 더해 방마다 다른 시드로
+    const char *journal_path; // 방마다 <경로>.<방 번호>에 저널 기록 (NULL이면 기록 안 함)
+} LobbyConfig;
+
 void error_handling(char *message);
-void send_game_info(int clnt_sd, GameInfo *game);
-void initialize_game(GameInfo *game, int width, int height, int tile_num, int play_time, int player_num);
+void encode_player_id(Buffer *buf, int p_num);
+void encode_game_info(Buffer *buf, GameInfo *game, View *view);
+void encode_game_delta(Buffer *buf, GameInfo *game, View *view);
+int view_follow(GameInfo *game, int p_num);
+void encode_tile_counts(Buffer *buf, GameInfo *game, int red_count, int blue_count, char winner);
+void send_game_info(GameInfo *game, int p_num);
+void fanout_set(FanoutFrame *frame, Buffer *buf);
+int fanout_send(FanoutFrame *frame, Connection *conn, int kind);
+void fanout_release(FanoutFrame *frame);
+void spectator_add(GameInfo *game, Connection *conn);
+void spectator_join(GameInfo *game, Connection *conn);
+void mark_cell_dirty(GameInfo *game, int x, int y);
+void collect_dirty(GameInfo *game);
+void clear_dirty(GameInfo *game);
+void broadcast_changes(GameInfo *game);
+void initialize_game(GameInfo *game, int width, int height, int tile_num, int play_time, int player_num, int use_bitplanes, unsigned int seed);
+void initialize_game_mapped(GameInfo *game, int width, int height, int play_time, int player_num, int use_bitplanes, unsigned int seed, char *board, Player *players);
 void process_player_command(char command, int player_id, GameInfo *game);
+void submit_commands(GameInfo *game, int p_num, char *commands, int len);
 void send_game_info_to_all_clients(GameInfo *game);
 void *client_handler(void *arg);
-void update_game_state(GameInfo *game);
+void update_game_state(GameInfo *game, int remaining_ms);
+int game_ended(GameInfo *game);
+void end_game(GameInfo *game, int *red_count, int *blue_count);
+void destroy_game(GameInfo *game);
+size_t game_memory_footprint(GameInfo *game);
 void calculate_tile_counts(GameInfo *game, int *red_count, int *blue_count);
-void send_tile_counts(int clnt_sd, int red_count, int blue_count, char winner);
+
+// conn.c
+Connection *conn_create(GameInfo *game, int fd, int p_num, int epfd);
+void conn_destroy(Connection *conn);
+void conn_flush(Connection *conn);
+int conn_send(Connection *conn, const void *data, size_t len, int kind);
+int conn_send_shared(Connection *conn, SharedBuf *buf, int kind);
+SharedBuf *shared_wrap(Buffer *buf);
+void shared_release(SharedBuf *buf);
+void conn_shutdown(Connection *conn);
+ssize_t conn_recv(Connection *conn, void *buf, size_t len);
+int conn_queue_depth(Connection *conn);
+
+// tick.c
+void enqueue_commands(GameInfo *game, int player_id, const char *commands, int count);
+void run_tick(GameInfo *game, int remaining_ms);
+void clock_start(GameInfo *game, int nonblock);
+int clock_on_timer(GameInfo *game);
+void clock_stop(GameInfo *game);
+
+// journal.c
+Journal *journal_open(const char *path, GameInfo *game);
+void journal_record(Journal *j, long tick, int player_id, char command);
+void journal_close(Journal *j);
+uint64_t game_checksum(GameInfo *game);
+int journal_replay(const char *path);
+
+// snapshot.c
+Snapshot *snapshot_create(const char *path, GameInfo *game);
+GameInfo *snapshot_restore(const char *path, int shared, int play_time, int use_bitplanes);
+void snapshot_save(GameInfo *game, int sync);
+void snapshot_periodic(GameInfo *game, long now_ns);
+void snapshot_close(GameInfo *game);
+int snapshot_generate(const char *path, int width, int height, int tile_num, int player_num, unsigned int seed);
+
+// bots.c
+void bots_start(GameInfo *game, int bot_num, int epoll_mode);
+void bots_step(GameInfo *game);
+void bots_free(GameInfo *game);
+
+// udp.c
+UdpChannel *udp_open(GameInfo *game, int port, int loss);
+void udp_close(UdpChannel *ch);
+void udp_offer(GameInfo *game, Connection *conn);
+int udp_send(GameInfo *game, Connection *conn, SharedBuf *frame);
+void udp_on_read(UdpChannel *ch);
+
+// bench.c
+int board_bench(int max_threads);
+
+// board.c
+void board_init(GameInfo *game, int use_bitplanes);
+void board_adopt(GameInfo *game, char *cells, int use_bitplanes);
+void board_free(GameInfo *game);
+void board_set(GameInfo *game, int x, int y, char tile);
+char board_flip(GameInfo *game, int x, int y);
+void board_index_build(GameInfo *game);
+int board_nearest(GameInfo *game, char tile, int x, int y, int *tx, int *ty);
+uint64_t board_hash_full(GameInfo *game);
+
+// reactor.c
+void reactor_start(int reactor_num);
+void reactor_add_client(GameInfo *game, int clnt_sd, int p_num);
+void reactor_start_game(GameInfo *game);
+void reactor_add_spectator(GameInfo *game, int clnt_sd);
+void reactor_wait_closed(void);
+void reactor_stop(void);
+int reactor_total(void);
+void reactor_watch(int reactor_idx, int fd, void *ptr);
+void reactor_unwatch(int reactor_idx, int fd);
+
+// stats.c
+void stats_start(int command_log_rate);
+void stats_record(int hist, long value);
+void stats_count(int counter, long n);
+long stats_counter(int counter);
+long stats_now_ns(void);
+void stats_dump(void);
+void game_lock(GameInfo *game);
+int game_trylock(GameInfo *game);
+void game_unlock(GameInfo *game);
+void log_command(int p_num, char command);
+
+// lobby.c
+void run_lobby(int serv_sd, LobbyConfig *cfg);
+void room_start(Room *room);
+void room_on_timer(Room *room);
+void room_conn_closed(Room *room, Connection *conn, int waiting);
+void room_reap(int reactor_idx);
 
 #endif // SERVER_H
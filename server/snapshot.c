@@ -0,0 +1,243 @@
+#include "server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 스냅샷/맵 파일 (보드와 플레이어를 이 파일에 매핑해 게임이 직접 읽고 씀)
+// 매핑한 그대로 쓰므로 호스트 바이트 순서와 Player 배치를 따름 (바뀌면 버전을 올림)
+//   머리 (64바이트): "TSNP", u32 버전, width, height, player_num, tile_num, i32 play_time (ms, 0이면 끝난 게임),
+//                   u32 seed, u64 tick, u64 checksum (마지막 스냅샷 시점의 플레이어 위치와 보드, board_hash_full 기반)
+//   플레이어: Player player_num개 (팀과 위치만 의미 있음)
+//   보드: width * height 바이트 (64바이트 경계에서 시작)
+#define SNAPSHOT_MAGIC "TSNP"
+#define SNAPSHOT_VERSION 2
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t player_num;
+    uint32_t tile_num;
+    int32_t play_time;
+    uint32_t seed;
+    uint64_t tick;
+    uint64_t checksum;
+    char reserved[16];
+} SnapshotHeader;
+
+struct Snapshot
+{
+    int fd;
+    char *map;
+    size_t size;
+    int shared;  // 1이면 파일에 반영 (-m), 0이면 맵을 불러오기만 함 (-M, 바뀐 페이지는 이 프로세스에만)
+    long next_ns; // 다음 스냅샷 시각 (저장할 때마다 SNAPSHOT_INTERVAL_MS 뒤로)
+    uint64_t board_hash; // 보드 해시 (shared면 game->board_hash가 가리켜 board_flip이 갱신)
+};
+
+static size_t board_offset(int player_num)
+{
+    return (sizeof(SnapshotHeader) + player_num * sizeof(Player) + 63) & ~(size_t)63;
+}
+
+static size_t file_size(int width, int height, int player_num)
+{
+    return board_offset(player_num) + (size_t)width * height;
+}
+
+// 보드 해시에 플레이어 위치를 더한 체크섬 (FNV-1a)
+// 보드 해시는 board_flip이 갱신하므로 스냅샷마다 플레이어 수만큼만 계산
+static uint64_t snapshot_checksum(uint64_t board_hash, const Player *players, int player_num)
+{
+    uint64_t h = 1469598103934665603ULL ^ board_hash;
+    for (int i = 0; i < player_num; i++)
+    {
+        uint64_t pos = (uint64_t)(uint32_t)players[i].x << 32 | (uint32_t)players[i].y;
+        h = (h ^ pos ^ (uint64_t)(unsigned char)players[i].team << 56) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static Snapshot *snapshot_map(int fd, size_t size, int shared)
+{
+    Snapshot *s = calloc(1, sizeof(Snapshot));
+    if (s == NULL)
+        error_handling("calloc() error");
+    s->fd = fd;
+    s->size = size;
+    s->shared = shared;
+    s->map = mmap(NULL, size, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if (s->map == MAP_FAILED)
+        error_handling("snapshot mmap() error");
+    return s;
+}
+
+// 게임의 보드와 플레이어를 새 스냅샷 파일로 옮기고 이후로는 파일 매핑을 직접 씀 (initialize_game 다음에 호출)
+Snapshot *snapshot_create(const char *path, GameInfo *game)
+{
+    size_t off = board_offset(game->player_num);
+    size_t cells = (size_t)game->width * game->height;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        error_handling("snapshot open() error");
+    if (ftruncate(fd, file_size(game->width, game->height, game->player_num)) < 0)
+        error_handling("snapshot ftruncate() error");
+    Snapshot *s = snapshot_map(fd, file_size(game->width, game->height, game->player_num), 1);
+
+    SnapshotHeader *h = (SnapshotHeader *)s->map;
+    memcpy(h->magic, SNAPSHOT_MAGIC, 4);
+    h->version = SNAPSHOT_VERSION;
+    h->width = game->width;
+    h->height = game->height;
+    h->player_num = game->player_num;
+    h->seed = game->seed;
+
+    memcpy(s->map + sizeof(SnapshotHeader), game->players, game->player_num * sizeof(Player));
+    memcpy(s->map + off, game->board, cells);
+    free(game->players);
+    free(game->board);
+    game->players = (Player *)(s->map + sizeof(SnapshotHeader));
+    game->board = s->map + off;
+    s->board_hash = board_hash_full(game);
+    game->board_hash = &s->board_hash;
+    return s;
+}
+
+// 머리와 크기가 맞고 플레이어가 모두 보드 안에 있는지
+static int snapshot_valid(const char *map, size_t size)
+{
+    const SnapshotHeader *h = (const SnapshotHeader *)map;
+    if (size < sizeof(SnapshotHeader) || memcmp(h->magic, SNAPSHOT_MAGIC, 4) != 0 || h->version != SNAPSHOT_VERSION ||
+        h->width == 0 || h->width > WIRE_MAX_DIM || h->height == 0 || h->height > WIRE_MAX_DIM ||
+        h->player_num == 0 || h->player_num > WIRE_MAX_DIM || size != file_size(h->width, h->height, h->player_num))
+        return 0;
+
+    const Player *players = (const Player *)(map + sizeof(SnapshotHeader));
+    for (uint32_t i = 0; i < h->player_num; i++)
+    {
+        if (players[i].x < 0 || players[i].x >= (int)h->width || players[i].y < 0 || players[i].y >= (int)h->height ||
+            (players[i].team != RED && players[i].team != BLUE))
+            return 0;
+    }
+    return 1;
+}
+
+// 스냅샷/맵 파일로 게임 복원 (반환값: shared이고 파일이 없으면 NULL -> 호출자가 새로 만듦)
+// shared: 1이면 파일을 계속 갱신하며 끝나지 않은 게임은 남은 시간과 tick부터 이어감 (-m)
+//         0이면 배치만 가져와 play_time으로 새 게임 시작, 파일은 바꾸지 않음 (-M)
+// 보드를 복사하지 않고 매핑하므로 복원 시간은 점수 계산과 보드 해시 계산(보드를 한 번씩 훑음)뿐
+GameInfo *snapshot_restore(const char *path, int shared, int play_time, int use_bitplanes)
+{
+    long t0 = stats_now_ns();
+    int fd = open(path, shared ? O_RDWR : O_RDONLY);
+    struct stat st;
+    if (fd < 0 && shared && errno == ENOENT)
+        return NULL;
+    if (fd < 0 || fstat(fd, &st) < 0)
+        error_handling("snapshot open() error");
+    if ((size_t)st.st_size < sizeof(SnapshotHeader))
+    {
+        fprintf(stderr, "%s: not a snapshot\n", path);
+        exit(1);
+    }
+
+    Snapshot *s = snapshot_map(fd, st.st_size, shared);
+    if (!snapshot_valid(s->map, s->size))
+    {
+        fprintf(stderr, "%s: not a snapshot\n", path);
+        exit(1);
+    }
+    SnapshotHeader *h = (SnapshotHeader *)s->map;
+    Player *players = (Player *)(s->map + sizeof(SnapshotHeader));
+    char *board = s->map + board_offset(h->player_num);
+    int resume = shared && h->play_time > 0;
+
+    GameInfo *game = malloc(sizeof(GameInfo));
+    if (game == NULL)
+        error_handling("malloc() error");
+    initialize_game_mapped(game, h->width, h->height, resume ? h->play_time : play_time, h->player_num, use_bitplanes,
+                           h->seed, board, players);
+    game->snapshot = s;
+    if (resume)
+        game->tick = h->tick;
+
+    // 프로세스가 죽어도 매핑에 쓴 내용은 파일에 남으므로 체크섬이 달라도 (마지막 스냅샷 이후 변경) 그대로 이어감
+    s->board_hash = board_hash_full(game);
+    int clean = snapshot_checksum(s->board_hash, players, h->player_num) == h->checksum;
+    if (shared)
+        game->board_hash = &s->board_hash;
+
+    printf("%s %s: %ux%u, %d tiles, %u players", resume ? "Resumed" : "Loaded", path, h->width, h->height,
+           game->tile_num, h->player_num);
+    if (resume)
+        printf(", tick %ld, %d ms left", game->tick, game->play_time);
+    printf(" in %.3f ms\n", (stats_now_ns() - t0) / 1e6);
+    if (!clean)
+        printf("Board changed after the last snapshot (tick %llu)\n", (unsigned long long)h->tick);
+    return game;
+}
+
+// 현재 상태를 머리에 적고 파일에 반영 (바뀐 페이지만 씀)
+// sync가 0이면 쓰기를 커널에 맡기고 바로 돌아옴 (주기 스냅샷: 게임 시계 스레드가 디스크를 기다리지 않음)
+// 1이면 디스크에 닿을 때까지 기다림 (게임 종료 후 마지막 저장)
+// 보드를 바꾸는 스레드가 없을 때 부르면 (틱 모드의 틱 사이, 게임 종료 후) 체크섬이 보드와 정확히 맞음
+void snapshot_save(GameInfo *game, int sync)
+{
+    Snapshot *s = game->snapshot;
+    if (s == NULL || !s->shared)
+        return;
+
+    long t0 = stats_now_ns();
+    SnapshotHeader *h = (SnapshotHeader *)s->map;
+    h->tile_num = game->tile_num;
+    h->play_time = game->play_time;
+    h->tick = game->tick;
+    h->checksum = snapshot_checksum(__atomic_load_n(&s->board_hash, __ATOMIC_RELAXED), game->players, game->player_num);
+    if (msync(s->map, s->size, sync ? MS_SYNC : MS_ASYNC) < 0)
+        error_handling("snapshot msync() error");
+    long now = stats_now_ns();
+    stats_record(ST_SNAPSHOT, now - t0);
+    s->next_ns = now + SNAPSHOT_INTERVAL_MS * 1000000L;
+}
+
+// 마지막 스냅샷 뒤 SNAPSHOT_INTERVAL_MS가 지났으면 스냅샷 (게임 시계 스레드에서 호출)
+void snapshot_periodic(GameInfo *game, long now_ns)
+{
+    Snapshot *s = game->snapshot;
+    if (s != NULL && s->shared && now_ns >= s->next_ns)
+        snapshot_save(game, 0);
+}
+
+// 매핑 해제 (보드와 플레이어도 함께 사라지므로 destroy_game에서 board_free 전에 호출)
+void snapshot_close(GameInfo *game)
+{
+    Snapshot *s = game->snapshot;
+    if (s == NULL)
+        return;
+    munmap(s->map, s->size);
+    close(s->fd);
+    free(s);
+    game->snapshot = NULL;
+    game->board_hash = NULL;
+    game->board = NULL;
+    game->players = NULL;
+}
+
+// 무작위 배치로 맵 파일을 만들고 끝냄 (큰 맵을 미리 만들어 두고 -M으로 불러옴)
+int snapshot_generate(const char *path, int width, int height, int tile_num, int player_num, unsigned int seed)
+{
+    long t0 = stats_now_ns();
+    GameInfo *game = malloc(sizeof(GameInfo));
+    if (game == NULL)
+        error_handling("malloc() error");
+    initialize_game(game, width, height, tile_num, 0, player_num, 0, seed);
+    game->snapshot = snapshot_create(path, game);
+    snapshot_save(game, 1); // play_time 0 -> 끝난 게임 (-m으로 열어도 이어가지 않고 배치만 씀)
+    printf("Map %s: %dx%d, %d tiles, %d players, seed %u in %.3f ms\n", path, width, height, tile_num, player_num, seed,
+           (stats_now_ns() - t0) / 1e6);
+    destroy_game(game);
+    return 0;
+}
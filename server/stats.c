@@ -0,0 +1,234 @@
+#include "server.h"
+#include <time.h>
+
+// 스레드별 통계 (자기 스레드에서만 쓰고, 출력할 때 모든 스레드 것을 합산)
+typedef struct ThreadStats
+{
+    Histogram hist[ST_HIST_COUNT];
+    long counters[ST_COUNTER_COUNT];
+    struct ThreadStats *next;
+} ThreadStats;
+
+static __thread ThreadStats *local;
+static ThreadStats *all_stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static long start_ns;
+
+// 명령 로그 속도 제한 (초당 log_rate줄, 0이면 끔)
+static int log_rate;
+static long log_second;
+static int log_lines;
+static long log_suppressed;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *hist_names[ST_HIST_COUNT] = {
+    "broadcast fan-out (ns)",
+    "bytes per broadcast",
+    "syscalls per broadcast",
+    "game lock wait (ns)",
+    "game lock hold (ns)",
+    "send queue depth",
+    "keyframe compress (ns)",
+    "keyframe ratio (%)",
+    "commands per read",
+    "snapshot (ns)",
+    "bot step (ns)",
+};
+
+static const char *counter_names[ST_COUNTER_COUNT] = {
+    "commands",
+    "broadcasts",
+    "bytes sent",
+    "send syscalls",
+    "frames encoded",
+    "keyframe raw bytes",
+    "keyframe packed bytes",
+    "udp datagrams",
+    "udp test drops",
+    "resync keyframes",
+    "late clock ticks",
+};
+
+long stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// 처음 쓰는 스레드는 자기 통계 블록을 만들어 목록에 등록
+static ThreadStats *stats_local(void)
+{
+    if (local == NULL)
+    {
+        local = calloc(1, sizeof(ThreadStats));
+        if (local == NULL)
+            error_handling("calloc() error");
+        pthread_mutex_lock(&stats_lock);
+        local->next = all_stats;
+        all_stats = local;
+        pthread_mutex_unlock(&stats_lock);
+    }
+    return local;
+}
+
+// 값 하나 기록 (2의 거듭제곱 구간별 개수)
+void stats_record(int hist, long value)
+{
+    Histogram *h = &stats_local()->hist[hist];
+    int bucket = value > 0 ? 64 - __builtin_clzl((unsigned long)value) : 0;
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max)
+        h->max = value;
+}
+
+void stats_count(int counter, long n)
+{
+    stats_local()->counters[counter] += n;
+}
+
+// 현재 스레드의 카운터 값 (구간 차이 계산용)
+long stats_counter(int counter)
+{
+    return stats_local()->counters[counter];
+}
+
+// game->lock 잡기 (기다린 시간 기록)
+void game_lock(GameInfo *game)
+{
+    long t0 = stats_now_ns();
+    pthread_mutex_lock(&game->lock);
+    game->lock_taken_ns = stats_now_ns();
+    stats_record(ST_LOCK_WAIT, game->lock_taken_ns - t0);
+}
+
+// game->lock을 기다리지 않고 잡기 (반환값: 1이면 잡음)
+int game_trylock(GameInfo *game)
+{
+    if (pthread_mutex_trylock(&game->lock) != 0)
+        return 0;
+    game->lock_taken_ns = stats_now_ns();
+    stats_record(ST_LOCK_WAIT, 0);
+    return 1;
+}
+
+// game->lock 풀기 (잡고 있던 시간 기록)
+void game_unlock(GameInfo *game)
+{
+    long held = stats_now_ns() - game->lock_taken_ns;
+    pthread_mutex_unlock(&game->lock);
+    stats_record(ST_LOCK_HOLD, held);
+}
+
+// 구간 값으로 백분위수 추정 (해당 구간의 상한)
+static long hist_percentile(Histogram *h, double p)
+{
+    long target = (long)(p * h->count);
+    long seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++)
+    {
+        seen += h->buckets[b];
+        if (seen > target)
+        {
+            long upper = b == 0 ? 0 : (b >= 63 ? h->max : (1L << b) - 1);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+// 모든 스레드 통계를 합산해 출력
+void stats_dump(void)
+{
+    Histogram total[ST_HIST_COUNT];
+    long counters[ST_COUNTER_COUNT] = {0};
+    memset(total, 0, sizeof(total));
+
+    pthread_mutex_lock(&stats_lock);
+    for (ThreadStats *s = all_stats; s; s = s->next)
+    {
+        for (int i = 0; i < ST_HIST_COUNT; i++)
+        {
+            total[i].count += s->hist[i].count;
+            total[i].sum += s->hist[i].sum;
+            if (s->hist[i].max > total[i].max)
+                total[i].max = s->hist[i].max;
+            for (int b = 0; b < HIST_BUCKETS; b++)
+                total[i].buckets[b] += s->hist[i].buckets[b];
+        }
+        for (int i = 0; i < ST_COUNTER_COUNT; i++)
+            counters[i] += s->counters[i];
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    double seconds = (stats_now_ns() - start_ns) / 1e9;
+    printf("\n=== Server stats (%.1f s) ===\n", seconds);
+    for (int i = 0; i < ST_COUNTER_COUNT; i++)
+        printf("%-24s %12ld  (%.1f/s)\n", counter_names[i], counters[i], counters[i] / seconds);
+    printf("%-24s %10s %10s %10s %10s %10s\n", "", "count", "avg", "p50", "p99", "max");
+    for (int i = 0; i < ST_HIST_COUNT; i++)
+    {
+        Histogram *h = &total[i];
+        if (h->count == 0)
+            continue;
+        printf("%-24s %10ld %10ld %10ld %10ld %10ld\n", hist_names[i], h->count, h->sum / h->count,
+               hist_percentile(h, 0.50), hist_percentile(h, 0.99), h->max);
+    }
+    if (counters[ST_KF_RAW] > 0)
+        printf("keyframe compression: %ld -> %ld bytes (%.1f%%)\n", counters[ST_KF_RAW], counters[ST_KF_PACKED],
+               100.0 * counters[ST_KF_PACKED] / counters[ST_KF_RAW]);
+    if (log_suppressed > 0)
+        printf("command log: %ld lines suppressed\n", log_suppressed);
+    fflush(stdout);
+}
+
+// SIGUSR1을 받을 때마다 통계 출력 (다른 스레드는 SIGUSR1을 막아 둠)
+static void *stats_signal_thread(void *arg)
+{
+    sigset_t *set = arg;
+    int sig;
+    while (sigwait(set, &sig) == 0)
+        stats_dump();
+    return NULL;
+}
+
+// 통계 시작 (다른 스레드를 만들기 전에 main에서 호출)
+void stats_start(int command_log_rate)
+{
+    static sigset_t set;
+    pthread_t thread;
+
+    start_ns = stats_now_ns();
+    log_rate = command_log_rate;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, NULL); // 이후 만드는 스레드도 물려받음
+    if (pthread_create(&thread, NULL, stats_signal_thread, &set) != 0)
+        error_handling("pthread_create() error");
+    pthread_detach(thread);
+}
+
+// 명령 로그 (초당 log_rate줄까지만, 넘는 것은 개수만 셈)
+void log_command(int p_num, char command)
+{
+    if (log_rate <= 0)
+        return;
+
+    long second = stats_now_ns() / 1000000000L;
+    pthread_mutex_lock(&log_lock);
+    if (second != log_second)
+    {
+        if (log_lines > log_rate)
+            printf("(%d command logs suppressed)\n", log_lines - log_rate);
+        log_second = second;
+        log_lines = 0;
+    }
+    if (log_lines++ < log_rate)
+        printf("Client %d command: %c\n", p_num, command);
+    else
+        log_suppressed++;
+    pthread_mutex_unlock(&log_lock);
+}
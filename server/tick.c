@@ -0,0 +1,136 @@
+#include "server.h"
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <time.h>
+
+// 한 번에 읽은 명령들을 다음 틱 큐에 추가 (I/O 스레드에서 호출, game->lock 불필요)
+void enqueue_commands(GameInfo *game, int player_id, const char *commands, int count)
+{
+    pthread_mutex_lock(&game->queue_lock);
+    CommandQueue *q = &game->pending;
+    if (q->count + count > q->cap)
+    {
+        while (q->count + count > q->cap)
+            q->cap = q->cap ? q->cap * 2 : 64;
+        q->items = realloc(q->items, q->cap * sizeof(Command));
+        if (q->items == NULL)
+            error_handling("realloc() error");
+    }
+    for (int i = 0; i < count; i++)
+    {
+        q->items[q->count].player_id = player_id;
+        q->items[q->count].command = commands[i];
+        q->count++;
+    }
+    pthread_mutex_unlock(&game->queue_lock);
+}
+
+// 한 틱 진행: 쌓인 명령을 한꺼번에 적용하고 브로드캐스트는 한 번만
+void run_tick(GameInfo *game, int remaining_ms)
+{
+    // 큐를 통째로 바꿔치기 -> 적용하는 동안 I/O 스레드는 새 큐에 계속 추가
+    pthread_mutex_lock(&game->queue_lock);
+    CommandQueue tmp = game->batch;
+    game->batch = game->pending;
+    game->pending = tmp;
+    game->pending.count = 0;
+    pthread_mutex_unlock(&game->queue_lock);
+
+    game_lock(game);
+    game->tick++;
+    for (int i = 0; i < game->batch.count; i++)
+    {
+        process_player_command(game->batch.items[i].command, game->batch.items[i].player_id, game);
+    }
+    game->play_time = remaining_ms;
+    send_game_info_to_all_clients(game);
+    game_unlock(game);
+
+    game->batch.count = 0;
+}
+
+static void ns_to_timespec(long ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / 1000000000L;
+    ts->tv_nsec = ns % 1000000000L;
+}
+
+// 다음 울릴 시각을 절대 시각으로 설정 (끝 시각을 넘지 않게)
+static void clock_arm(GameClock *clock)
+{
+    struct itimerspec its = {0};
+    if (clock->next_ns > clock->end_ns)
+        clock->next_ns = clock->end_ns;
+    ns_to_timespec(clock->next_ns, &its.it_value);
+    timerfd_settime(clock->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// 게임 시계 시작 (모두 준비된 시점에 호출, play_time ms 뒤에 끝남)
+// nonblock: 리액터에 등록해 쓰면 1, clock_on_timer에서 기다리며 쓰면 0
+void clock_start(GameInfo *game, int nonblock)
+{
+    GameClock *clock = &game->clock;
+    if (game->tick_rate > 0)
+        clock->interval_ns = 1000000000L / game->tick_rate;
+    else // 봇이 있으면 봇이 움직이는 간격마다 (사람의 명령은 시계와 무관하게 바로 적용)
+        clock->interval_ns = (game->bot_num > 0 ? BOT_INTERVAL_MS : CLOCK_INTERVAL_MS) * 1000000L;
+    clock->start_ns = stats_now_ns(); // timerfd와 같은 CLOCK_MONOTONIC
+    clock->end_ns = clock->start_ns + game->play_time * 1000000L;
+    clock->next_ns = clock->start_ns + clock->interval_ns;
+
+    clock->timer_fd = timerfd_create(CLOCK_MONOTONIC, nonblock ? TFD_NONBLOCK : 0);
+    if (clock->timer_fd < 0)
+        error_handling("timerfd_create() error");
+    clock_arm(clock);
+}
+
+// 시계가 울렸을 때 처리 (timerfd를 읽는 스레드 하나에서, game->lock 없이 호출)
+// 틱 모드면 쌓인 명령 적용 후 브로드캐스트, 아니면 남은 시간만 알림
+// 처리가 밀려 격자를 여러 칸 지났으면 한 번으로 합치고 다음 격자로 (시계는 밀리지 않음)
+// 끝 시각이면 먼저 game->ended를 알려 I/O 스레드가 명령을 더 받지 않게 하고, 적용 중인 배치를 기다린 뒤 마지막 상태를 보냄
+// 반환값: 1이면 게임 시간이 끝남 (호출자가 end_game)
+int clock_on_timer(GameInfo *game)
+{
+    GameClock *clock = &game->clock;
+    uint64_t expirations;
+    if (read(clock->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0; // 논블로킹에서 아직 안 울림
+
+    long now = stats_now_ns();
+    int remaining_ms = now < clock->end_ns ? (int)((clock->end_ns - now + 999999) / 1000000) : 0;
+    if (remaining_ms == 0)
+    { // 이후 I/O 스레드는 명령을 버림 -> 이미 적용 중인 배치만 끝나면 보드가 멈춤
+        __atomic_store_n(&game->ended, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&game->inflight, __ATOMIC_SEQ_CST) > 0)
+            sched_yield();
+    }
+    else if (game->bot_num > 0)
+        bots_step(game); // 틱 모드면 이 틱에 함께 브로드캐스트됨
+
+    if (game->tick_rate > 0)
+        run_tick(game, remaining_ms);
+    else
+        update_game_state(game, remaining_ms);
+
+    if (remaining_ms == 0)
+        return 1;
+    snapshot_periodic(game, now); // 틱 모드면 틱 사이라 보드가 멈춰 있음
+
+    // 처리하는 동안 지난 격자도 늦은 것으로 셈 (이미 지난 시각으로 다시 맞추지 않음)
+    now = stats_now_ns();
+    clock->next_ns += clock->interval_ns;
+    while (clock->next_ns <= now)
+    {
+        clock->next_ns += clock->interval_ns;
+        stats_count(ST_CLOCK_LATE, 1);
+    }
+    clock_arm(clock);
+    return 0;
+}
+
+void clock_stop(GameInfo *game)
+{
+    if (game->clock.timer_fd >= 0)
+        close(game->clock.timer_fd);
+    game->clock.timer_fd = -1;
+}
@@ -0,0 +1,163 @@
+#include "server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// UDP 상태 채널: 핸드셰이크에서 요청한 플레이어에게 델타와 주기 키프레임을 UDP로 보냄
+// 잃은 패킷 하나가 뒤의 모든 상태를 막는 TCP와 달리 늦거나 잃은 상태는 건너뛰고 최신 상태를 바로 적용
+// 명령, 재동기화 키프레임, 결과는 그대로 TCP
+struct UdpChannel
+{
+    int ev_type;      // EV_UDP
+    int fd;           // 모든 플레이어가 함께 쓰는 UDP 소켓
+    int port;
+    int loss;         // 보낼 때 일부러 버리는 비율 (%, 손실 시험용)
+    unsigned int rng; // 토큰과 손실 시험용 난수 상태 (game->lock으로 보호)
+    GameInfo *game;
+};
+
+// UDP 소켓을 열고 리액터 0번에 등록 (reactor_start 다음에 호출)
+UdpChannel *udp_open(GameInfo *game, int port, int loss)
+{
+    UdpChannel *ch = calloc(1, sizeof(UdpChannel));
+    if (ch == NULL)
+        error_handling("calloc() error");
+    ch->ev_type = EV_UDP;
+    ch->port = port;
+    ch->loss = loss;
+    ch->rng = game->seed ^ (unsigned int)getpid();
+    ch->game = game;
+
+    struct sockaddr_in adr;
+    memset(&adr, 0, sizeof(adr));
+    adr.sin_family = AF_INET;
+    adr.sin_addr.s_addr = htonl(INADDR_ANY);
+    adr.sin_port = htons(port);
+
+    ch->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (ch->fd < 0)
+        error_handling("UDP socket creation failed");
+    if (bind(ch->fd, (struct sockaddr *)&adr, sizeof(adr)) < 0)
+        error_handling("UDP bind() error");
+    fcntl(ch->fd, F_SETFL, fcntl(ch->fd, F_GETFL, 0) | O_NONBLOCK);
+
+    reactor_watch(0, ch->fd, ch);
+    return ch;
+}
+
+// 리액터를 멈춘 뒤 호출 (destroy_game)
+void udp_close(UdpChannel *ch)
+{
+    if (ch == NULL)
+        return;
+    close(ch->fd);
+    free(ch);
+}
+
+// UDP 채널 안내 전송 (game->lock 보유 상태에서 호출)
+// 토큰 하위 16비트는 플레이어 번호 -> 등록 데이터그램이 어느 연결 것인지 바로 찾음
+void udp_offer(GameInfo *game, Connection *conn)
+{
+    UdpChannel *ch = game->udp;
+    if (ch == NULL || conn->spectator || conn->udp_token != 0)
+        return;
+    conn->udp_token = (uint32_t)(rand_r(&ch->rng) % 0xffff + 1) << 16 | conn->p_num;
+
+    Buffer buf = {0};
+    size_t start = frame_begin(&buf, MSG_UDP_OFFER, game->seq);
+    put_u16(&buf, ch->port);
+    put_u32(&buf, conn->udp_token);
+    frame_end(&buf, start);
+    conn_send(conn, buf.data, buf.len, OUT_CONTROL);
+    buf_free(&buf);
+}
+
+// 상태 프레임을 UDP로 전송 (game->lock 보유 상태에서 호출)
+// 직전에 보낸 프레임을 앞에 함께 실음 -> 데이터그램 하나를 잃어도 다음 것으로 복구
+// 반환값: 1 = UDP로 보냄 (손실 시험으로 버린 것 포함), 0 = UDP를 쓰지 않거나 한 데이터그램에 안 들어감 -> TCP로
+int udp_send(GameInfo *game, Connection *conn, SharedBuf *frame)
+{
+    UdpChannel *ch = game->udp;
+    if (ch == NULL || !conn->udp_ready || frame->len > UDP_MAX_PAYLOAD)
+        return 0;
+
+    struct iovec iov[2];
+    int n = 0;
+    SharedBuf *prev = conn->udp_prev;
+    if (prev && prev->len + frame->len <= UDP_MAX_PAYLOAD)
+    {
+        iov[n].iov_base = prev->data;
+        iov[n].iov_len = prev->len;
+        n++;
+    }
+    iov[n].iov_base = frame->data;
+    iov[n].iov_len = frame->len;
+    n++;
+
+    if (ch->loss > 0 && rand_r(&ch->rng) % 100 < ch->loss)
+    {
+        stats_count(ST_UDP_LOST, 1);
+    }
+    else
+    {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &conn->udp_addr;
+        msg.msg_namelen = sizeof(conn->udp_addr);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        // 소켓 버퍼가 차서 못 보내면 잃은 것과 같음 -> 기다리지 않음
+        ssize_t sent = sendmsg(ch->fd, &msg, MSG_DONTWAIT);
+        stats_count(ST_SYSCALLS, 1);
+        if (sent > 0)
+        {
+            stats_count(ST_BYTES_SENT, sent);
+            stats_count(ST_UDP_SENT, 1);
+        }
+    }
+
+    __atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+    conn->udp_prev = frame;
+    shared_release(prev);
+    return 1;
+}
+
+// 등록 데이터그램 처리 (리액터 스레드에서 호출): 토큰이 맞으면 보낸 주소로 상태를 보내기 시작하고 토큰으로 응답
+// 클라이언트는 응답을 받을 때까지 등록을 다시 보냄
+void udp_on_read(UdpChannel *ch)
+{
+    GameInfo *game = ch->game;
+    char data[64];
+    struct sockaddr_in from;
+
+    while (1)
+    {
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(ch->fd, data, sizeof(data), 0, (struct sockaddr *)&from, &from_len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return; // EAGAIN
+        }
+
+        Cursor c = {data, n, 0};
+        uint32_t token;
+        if (n != 4 || get_u32(&c, &token) < 0)
+            continue;
+        int p_num = token & 0xffff;
+
+        game_lock(game);
+        Connection *conn = p_num < game->player_num ? game->conns[p_num] : NULL;
+        if (conn && conn->udp_token == token)
+        {
+            if (!conn->udp_ready)
+                printf("Client %d UDP channel ready.\n", p_num);
+            conn->udp_addr = from;
+            conn->udp_ready = 1;
+            sendto(ch->fd, data, n, MSG_DONTWAIT, (struct sockaddr *)&from, from_len);
+        }
+        game_unlock(game);
+    }
+}